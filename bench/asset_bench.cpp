@@ -0,0 +1,314 @@
+// Microbenchmarks for the asset pipeline.
+//
+// usage: ./asset_bench [options] [obj files...]
+//   --iterations N      timed repetitions per stage (default 15)
+//   --save FILE         write the results as a baseline
+//   --compare FILE      compare against a baseline, exit 1 on regression
+//   --threshold PCT     allowed slowdown before flagging (default 10)
+//   --no-gl             skip the stages that need an OpenGL context
+//
+// With no files given every .obj in obj_files/ is benchmarked.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "../src/Mesh.hpp"
+#include "../src/Model.hpp"
+#include "../src/load_obj.hpp"
+
+// Allocation counting, only active while a stage is being measured
+static std::atomic<bool> g_counting{false};
+static std::atomic<size_t> g_alloc_count{0};
+static std::atomic<size_t> g_alloc_bytes{0};
+
+// Keeps the optimiser from discarding the measured work
+static volatile size_t g_sink = 0;
+
+void *operator new(std::size_t size) {
+  if (g_counting.load(std::memory_order_relaxed)) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct StageResult {
+  std::string file;
+  std::string stage;
+  double median_ns = 0.0;
+  double min_ns = 0.0;
+  double allocs = 0.0; // per iteration
+  double alloc_bytes = 0.0;
+  size_t bytes = 0;    // input bytes processed per iteration
+  size_t vertices = 0; // vertices processed per iteration
+};
+
+/**
+ * @brief Runs body once untimed to warm up, then iterations times, recording the median and minimum
+ *
+ */
+static StageResult measure(const std::string &file, const std::string &stage, int iterations,
+                           const std::function<void()> &body) {
+  using clock = std::chrono::steady_clock;
+
+  body();
+
+  std::vector<double> samples;
+  samples.reserve(iterations);
+
+  g_alloc_count = 0;
+  g_alloc_bytes = 0;
+  for (int i = 0; i < iterations; i++) {
+    g_counting = true;
+    auto start = clock::now();
+    body();
+    auto end = clock::now();
+    g_counting = false;
+    samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  StageResult r;
+  r.file = file;
+  r.stage = stage;
+  r.median_ns = samples[samples.size() / 2];
+  r.min_ns = samples.front();
+  r.allocs = static_cast<double>(g_alloc_count) / iterations;
+  r.alloc_bytes = static_cast<double>(g_alloc_bytes) / iterations;
+  return r;
+}
+
+static std::vector<std::string> read_lines(const std::string &path) {
+  std::vector<std::string> lines;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line))
+    lines.push_back(line);
+  return lines;
+}
+
+static std::map<std::string, StageResult> load_baseline(const std::string &path) {
+  std::map<std::string, StageResult> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    StageResult r;
+    if (iss >> r.file >> r.stage >> r.median_ns >> r.min_ns >> r.allocs)
+      baseline[r.file + ' ' + r.stage] = r;
+  }
+  return baseline;
+}
+
+static void save_baseline(const std::string &path, const std::vector<StageResult> &results) {
+  std::ofstream file(path);
+  file << "# file stage median_ns min_ns allocs_per_iter\n";
+  for (const auto &r : results)
+    file << r.file << ' ' << r.stage << ' ' << std::fixed << std::setprecision(0) << r.median_ns << ' '
+         << r.min_ns << ' ' << std::defaultfloat << std::setprecision(std::numeric_limits<double>::max_digits10)
+         << r.allocs << '\n'; // exact, the comparison has no tolerance for allocations
+}
+
+int main(int argc, char **argv) {
+  int iterations = 15;
+  double threshold = 10.0;
+  bool use_gl = true;
+  std::string save_path, compare_path;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--iterations" && i + 1 < argc)
+      iterations = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--save" && i + 1 < argc)
+      save_path = argv[++i];
+    else if (arg == "--compare" && i + 1 < argc)
+      compare_path = argv[++i];
+    else if (arg == "--threshold" && i + 1 < argc)
+      threshold = std::atof(argv[++i]);
+    else if (arg == "--no-gl")
+      use_gl = false;
+    else if (arg.rfind("--", 0) == 0) {
+      std::cout << "Unknown option: " << arg << '\n';
+      return 1;
+    } else
+      files.push_back(arg);
+  }
+
+  if (files.empty()) {
+    for (const auto &entry : std::filesystem::directory_iterator("obj_files"))
+      if (entry.path().extension() == ".obj")
+        files.push_back(entry.path().string());
+    std::sort(files.begin(), files.end());
+  }
+
+  // Model stages need a context, a hidden window is enough
+  GLFWwindow *window = nullptr;
+  if (use_gl && glfwInit()) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    window = glfwCreateWindow(64, 64, "asset_bench", nullptr, nullptr);
+    if (window) {
+      glfwMakeContextCurrent(window);
+      glewExperimental = GL_TRUE;
+      if (glewInit() != GLEW_OK) {
+        glfwDestroyWindow(window);
+        window = nullptr;
+      }
+    }
+  }
+  if (use_gl && !window)
+    std::cerr << "No OpenGL context, skipping Model stages\n";
+
+  std::vector<StageResult> results;
+
+  for (const auto &path : files) {
+    std::string name = std::filesystem::path(path).filename().string();
+    std::vector<std::string> lines = read_lines(path);
+    size_t file_bytes = std::filesystem::file_size(path);
+
+    std::optional<Mesh> reference = load_obj_mesh(path);
+    if (!reference.has_value()) {
+      std::cerr << "Couldn't load file: " << path << '\n';
+      continue;
+    }
+    size_t vertex_count = reference->vertices.size();
+
+    std::vector<std::string> face_tokens;
+    for (const auto &line : lines) {
+      auto split = split_at_whitespace(line);
+      if (!split.empty() && split[0] == "f")
+        face_tokens.insert(face_tokens.end(), split.begin() + 1, split.end());
+    }
+
+    size_t sink = 0;
+
+    StageResult r = measure(name, "split_at_whitespace", iterations, [&] {
+      for (const auto &line : lines)
+        sink += split_at_whitespace(line).size();
+    });
+    r.bytes = file_bytes;
+    results.push_back(r);
+
+    r = measure(name, "extract_first_num", iterations, [&] {
+      for (const auto &token : face_tokens)
+        sink += extract_first_num(token, '/').size();
+    });
+    results.push_back(r);
+
+    r = measure(name, "load_obj", iterations, [&] {
+      auto mesh = load_obj_mesh(path);
+      sink += mesh->indices.size();
+    });
+    r.bytes = file_bytes;
+    r.vertices = vertex_count;
+    results.push_back(r);
+
+    r = measure(name, "mesh_construct", iterations, [&] {
+      Mesh mesh(reference->vertices, reference->indices);
+      sink += mesh.vertices.size();
+    });
+    r.vertices = vertex_count;
+    results.push_back(r);
+
+    if (window) {
+      std::optional<Model> slots[2];
+      slots[0].emplace(*reference);
+      int current = 0;
+      r = measure(name, "model_move", iterations, [&] {
+        slots[1 - current].emplace(std::move(*slots[current]));
+        slots[current].reset();
+        current = 1 - current;
+      });
+      r.vertices = vertex_count;
+      results.push_back(r);
+    }
+
+    g_sink = sink;
+  }
+
+  std::cout << std::left << std::setw(22) << "file" << std::setw(22) << "stage" << std::right << std::setw(12)
+            << "median us" << std::setw(12) << "min us" << std::setw(10) << "allocs" << std::setw(12) << "alloc KB"
+            << std::setw(10) << "MB/s" << std::setw(14) << "Mverts/s" << '\n';
+  for (const auto &r : results) {
+    double seconds = r.median_ns * 1e-9;
+    std::cout << std::left << std::setw(22) << r.file << std::setw(22) << r.stage << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << r.median_ns / 1000.0 << std::setw(12) << r.min_ns / 1000.0
+              << std::setw(10) << r.allocs << std::setw(12) << r.alloc_bytes / 1024.0;
+    if (r.bytes)
+      std::cout << std::setw(10) << (r.bytes / (1024.0 * 1024.0)) / seconds;
+    else
+      std::cout << std::setw(10) << '-';
+    if (r.vertices)
+      std::cout << std::setw(14) << std::setprecision(2) << (r.vertices / 1e6) / seconds;
+    else
+      std::cout << std::setw(14) << '-';
+    std::cout << '\n';
+  }
+
+  int regressions = 0;
+  if (!compare_path.empty()) {
+    auto baseline = load_baseline(compare_path);
+    if (baseline.empty())
+      std::cerr << "Baseline " << compare_path << " is empty or missing\n";
+
+    std::cout << "\nComparison against " << compare_path << " (threshold " << threshold << "%):\n";
+    for (const auto &r : results) {
+      auto it = baseline.find(r.file + ' ' + r.stage);
+      if (it == baseline.end())
+        continue;
+      const StageResult &b = it->second;
+      // The minimum is far less sensitive to scheduler noise than the median
+      double change = (r.min_ns - b.min_ns) / b.min_ns * 100.0;
+      bool slower = change > threshold;
+      bool more_allocs = r.allocs > b.allocs;
+      if (slower || more_allocs)
+        regressions++;
+      std::cout << (slower || more_allocs ? "REGRESSION " : "ok         ") << std::left << std::setw(22) << r.file
+                << std::setw(22) << r.stage << std::right << std::showpos << std::setprecision(1) << change << '%'
+                << std::noshowpos;
+      if (more_allocs)
+        std::cout << "  allocs " << b.allocs << " -> " << r.allocs;
+      std::cout << '\n';
+    }
+  }
+
+  if (!save_path.empty())
+    save_baseline(save_path, results);
+
+  if (window) {
+    glfwDestroyWindow(window);
+    glfwTerminate();
+  }
+
+  return regressions ? 1 : 0;
+}
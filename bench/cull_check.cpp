@@ -0,0 +1,76 @@
+// Checks the CPU occlusion culler against a scene with a known answer, no GPU needed.
+//
+// usage: ./cull_check
+//
+// A wall quad faces the camera; boxes behind it must be culled, boxes in front of it, beside it
+// or crossing the near plane must stay visible, and boxes outside the view must be frustum culled.
+// Exits 1 if any box gets the wrong answer.
+
+#include <iostream>
+#include <vector>
+
+#include "../src/Math.hpp"
+#include "../src/OcclusionCuller.hpp"
+#include "../src/Vertex.hpp"
+
+struct Case {
+  const char *name;
+  math::AABB box;
+  bool visible;
+};
+
+int main() {
+  math::Mat4 view = math::look_at({0.0f, 0.0f, 5.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+  math::Mat4 projection = math::perspective(math::radians(60.0f), 1.6f, 0.1f, 100.0f);
+
+  // A 4x4 wall at z = 0, both triangles wound the same way
+  std::vector<Vertex> wall = {Vertex({-2.0f, -2.0f, 0.0f}, {1.0f, 1.0f, 1.0f}),
+                              Vertex({2.0f, -2.0f, 0.0f}, {1.0f, 1.0f, 1.0f}),
+                              Vertex({2.0f, 2.0f, 0.0f}, {1.0f, 1.0f, 1.0f}),
+                              Vertex({-2.0f, 2.0f, 0.0f}, {1.0f, 1.0f, 1.0f})};
+  std::vector<GLushort> indices = {0, 1, 2, 0, 2, 3};
+
+  const Case cases[] = {
+      {"behind the wall", {{-0.5f, -0.5f, -3.0f}, {0.5f, 0.5f, -2.0f}}, false},
+      {"far behind the wall", {{-1.0f, -1.0f, -40.0f}, {1.0f, 1.0f, -30.0f}}, false},
+      {"in front of the wall", {{-0.5f, -0.5f, 1.0f}, {0.5f, 0.5f, 2.0f}}, true},
+      {"behind, past the wall's edge", {{5.0f, -0.5f, -3.0f}, {6.0f, 0.5f, -2.0f}}, true},
+      {"behind, straddling the edge", {{1.5f, -0.5f, -1.0f}, {2.5f, 0.5f, -0.5f}}, true},
+      {"crossing the near plane", {{-1.0f, -1.0f, 4.0f}, {1.0f, 1.0f, 6.0f}}, true},
+      {"off to the side", {{100.0f, -1.0f, -5.0f}, {101.0f, 1.0f, -4.0f}}, false},
+      {"behind the camera", {{-1.0f, -1.0f, 10.0f}, {1.0f, 1.0f, 12.0f}}, true}, // crosses w = 0, kept
+  };
+
+  int failures = 0;
+  OcclusionCuller culler;
+  culler.begin_frame(projection * view);
+  culler.add_occluder(math::Mat4::identity(), wall.data(), wall.size(), indices.data(), indices.size());
+  culler.finish();
+  for (const Case &c : cases) {
+    bool visible = culler.is_visible(c.box);
+    if (visible != c.visible) {
+      std::cerr << c.name << ": " << (visible ? "visible" : "culled") << ", expected "
+                << (c.visible ? "visible" : "culled") << '\n';
+      failures++;
+    }
+  }
+  const OcclusionCuller::Stats &stats = culler.stats();
+  std::cout << "cull_check: " << stats.tested << " boxes, " << stats.occluded << " occluded, " << stats.frustum_culled
+            << " outside the view, " << stats.occluder_triangles << " occluder triangles\n";
+  if (stats.occluded != 2 || stats.frustum_culled != 1) {
+    std::cerr << "expected 2 occluded and 1 outside the view\n";
+    failures++;
+  }
+
+  // Without occluders nothing in view may be culled
+  culler.begin_frame(projection * view);
+  culler.finish();
+  if (culler.has_occluders() || !culler.is_visible(cases[0].box)) {
+    std::cerr << "a box was culled without occluders\n";
+    failures++;
+  }
+
+  if (failures)
+    std::cerr << failures << " failures\n";
+  return failures ? 1 : 0;
+}
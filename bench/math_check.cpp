@@ -0,0 +1,163 @@
+// Checks that the SSE, AVX and scalar builds of the batched math kernels agree bit for bit.
+//
+// usage: ./math_check --write FILE         save this build's outputs
+//        ./math_check --compare FILE...    compare this build's outputs with saved ones, exit 1 on any difference
+//
+// `make math_check` builds it with -msse4.2, with -mavx2 and with MATH_FORCE_SCALAR and compares all three.
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/Math.hpp"
+
+#if MATH_AVX
+static const char *const g_path = "AVX";
+#elif MATH_SSE
+static const char *const g_path = "SSE";
+#else
+static const char *const g_path = "scalar";
+#endif
+
+// Batch sizes around the 2 and 4 wide steps of the SIMD paths, so every tail length is covered
+static const size_t g_sizes[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 17, 37};
+
+struct Section {
+  std::string name;
+  std::vector<uint8_t> bytes;
+};
+
+// Same sequence in every build: integer state, converted to floats exactly
+struct Inputs {
+  uint32_t state = 12345;
+
+  float next() {
+    state = state * 1664525u + 1013904223u;
+    int32_t v = static_cast<int32_t>(state >> 8) - (1 << 23);
+    switch (state & 15) {
+    case 0: return 0.0f;
+    case 1: return -0.0f;
+    case 2: return static_cast<float>(v) / 1024.0f; // up to a few thousand
+    default: return static_cast<float>(v) / static_cast<float>(1 << 23);
+    }
+  }
+
+  math::Mat4 matrix() {
+    math::Mat4 m;
+    for (math::Vec4 &c : m.cols)
+      c = {next(), next(), next(), next()};
+    return m;
+  }
+
+  math::Vec3 point() { return {next(), next(), next()}; }
+
+  math::AABB box() {
+    math::Vec3 a = point(), b = point();
+    return {{std::fmin(a.x, b.x), std::fmin(a.y, b.y), std::fmin(a.z, b.z)},
+            {std::fmax(a.x, b.x), std::fmax(a.y, b.y), std::fmax(a.z, b.z)}};
+  }
+};
+
+template <typename T> void append(Section &section, const T *data, size_t n) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  section.bytes.insert(section.bytes.end(), bytes, bytes + n * sizeof(T));
+}
+
+std::vector<Section> run_kernels() {
+  Inputs in;
+  std::vector<Section> sections;
+  for (size_t n : g_sizes) {
+    std::string suffix = " n=" + std::to_string(n);
+    math::Mat4 m = in.matrix();
+    std::vector<math::Mat4> as(n), bs(n), out(n);
+    std::vector<math::Vec3> points(n), transformed(n);
+    std::vector<math::AABB> boxes(n), bounds(n);
+    for (size_t i = 0; i < n; i++) {
+      as[i] = in.matrix();
+      bs[i] = in.matrix();
+      points[i] = in.point();
+      boxes[i] = in.box();
+    }
+
+    Section section{"mul_batch(Mat4 *, Mat4 *)" + suffix, {}};
+    math::mul_batch(as.data(), bs.data(), out.data(), n);
+    append(section, out.data(), n);
+    sections.push_back(std::move(section));
+
+    section = {"mul_batch(Mat4, Mat4 *)" + suffix, {}};
+    math::mul_batch(m, bs.data(), out.data(), n);
+    append(section, out.data(), n);
+    sections.push_back(std::move(section));
+
+    section = {"transform_points" + suffix, {}};
+    math::transform_points(m, points.data(), transformed.data(), n);
+    append(section, transformed.data(), n);
+    math::transform_points(m, points.data(), points.data(), n); // in place
+    append(section, points.data(), n);
+    sections.push_back(std::move(section));
+
+    section = {"transform_aabbs" + suffix, {}};
+    math::transform_aabbs(m, boxes.data(), bounds.data(), n);
+    append(section, bounds.data(), n);
+    sections.push_back(std::move(section));
+  }
+  return sections;
+}
+
+std::vector<uint8_t> concatenate(const std::vector<Section> &sections) {
+  std::vector<uint8_t> all;
+  for (const Section &s : sections)
+    all.insert(all.end(), s.bytes.begin(), s.bytes.end());
+  return all;
+}
+
+int main(int argc, char **argv) {
+  std::vector<Section> sections = run_kernels();
+  std::vector<uint8_t> ours = concatenate(sections);
+  std::cout << "math_check: " << g_path << " build, " << ours.size() << " bytes of results\n";
+
+  if (argc == 3 && std::string(argv[1]) == "--write") {
+    std::ofstream file(argv[2], std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(ours.data()), ours.size());
+    if (!file) {
+      std::cerr << "Couldn't write " << argv[2] << '\n';
+      return 1;
+    }
+    return 0;
+  }
+
+  if (argc < 3 || std::string(argv[1]) != "--compare") {
+    std::cerr << "usage: " << argv[0] << " --write FILE | --compare FILE...\n";
+    return 2;
+  }
+
+  int status = 0;
+  for (int i = 2; i < argc; i++) {
+    std::ifstream file(argv[i], std::ios::binary);
+    std::vector<uint8_t> theirs((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (theirs.size() != ours.size()) {
+      std::cerr << argv[i] << ": " << theirs.size() << " bytes, expected " << ours.size() << '\n';
+      status = 1;
+      continue;
+    }
+
+    size_t offset = 0;
+    bool same = true;
+    for (const Section &s : sections) {
+      if (std::memcmp(s.bytes.data(), theirs.data() + offset, s.bytes.size()) != 0) {
+        std::cerr << argv[i] << ": " << s.name << " differs from the " << g_path << " build\n";
+        same = false;
+      }
+      offset += s.bytes.size();
+    }
+    if (same)
+      std::cout << argv[i] << ": identical\n";
+    else
+      status = 1;
+  }
+  return status;
+}
@@ -1,8 +1,16 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -12,15 +20,35 @@
 #include "lib/imgui/backends/imgui_impl_opengl3.h"
 #include "lib/imgui/imgui.h"
 
+#include "src/AllocationWidget.hpp"
+#include "src/AssetWidget.hpp"
+#include "src/CollisionWidget.hpp"
 #include "src/ButtonWidget.hpp"
 #include "src/CollapsibleSectionWidget.hpp"
 #include "src/ConsoleWidget.hpp"
-
+#include "src/CullingWidget.hpp"
+#include "src/DynamicGeometryWidget.hpp"
+#include "src/PagingWidget.hpp"
+#include "src/PickWidget.hpp"
+#include "src/PointCloudWidget.hpp"
+#include "src/SceneWidget.hpp"
+#include "src/StatsWidget.hpp"
+
+#include "src/AllocationTracker.hpp"
+#include "src/AssetRegistry.hpp"
 #include "src/Camera.hpp"
+#include "src/CameraPath.hpp"
+#include "src/FrameArena.hpp"
+#include "src/FrameCapture.hpp"
+#include "src/FramePacer.hpp"
+#include "src/FrameStats.hpp"
 #include "src/Menu.hpp"
 #include "src/Mesh.hpp"
 #include "src/Model.hpp"
+#include "src/PagedGeometry.hpp"
 #include "src/Renderer.hpp"
+#include "src/SceneGraph.hpp"
+#include "src/WaveSurface.hpp"
 #include "src/load_obj.hpp"
 
 const GLint WIDTH = 1200, HEIGHT = 800;
@@ -32,14 +60,45 @@ bool is_float(const std::string &str) {
   return iss.eof() && !iss.fail();
 }
 
+// A frame number: decimal digits only, no sign, nothing after them
+bool parse_frame_number(const char *str, size_t &frame) {
+  if (!std::isdigit(static_cast<unsigned char>(str[0])))
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  unsigned long value = std::strtoul(str, &end, 10);
+  if (*end != '\0' || errno == ERANGE)
+    return false;
+  frame = value;
+  return true;
+}
+
+void print_usage() {
+  std::cout << "usage: ./main (obj_file, scene_file or pages_file) (GL_POINTS or GL_TRIANGLES or GL_LINES) (distance) (optional: fps) [options]\n"
+               "  --record FILE          record the camera path to FILE\n"
+               "  --replay FILE          replay a recorded camera path with a fixed timestep, then exit\n"
+               "  --replay-report FILE   write per-frame replay timings to FILE as csv\n"
+               "  --screenshot N FILE    save drawn frame N (replay frame N with --replay) to FILE, .png or .ppm\n"
+               "  --occluder             rasterize the obj_file as an occluder (scene files mark nodes instead)\n";
+}
+
 float lastX = WIDTH / 2.0f;
 float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 Camera *camera_ptr = nullptr;
+FramePacer *pacer_ptr = nullptr;
 bool camera_mode = true;
+bool replaying = false;
+
+// Mouse movement applied to the camera since the start of the frame, for path recording
+float frame_mouse_dx = 0.0f;
+float frame_mouse_dy = 0.0f;
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
-  if (!camera_ptr || !camera_mode)
+  if (pacer_ptr)
+    pacer_ptr->notify_input();
+
+  if (!camera_ptr || !camera_mode || replaying)
     return;
 
   if (firstMouse) {
@@ -53,15 +112,38 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
   lastX = static_cast<float>(xpos);
   lastY = static_cast<float>(ypos);
 
+  frame_mouse_dx += xoffset;
+  frame_mouse_dy += yoffset;
   camera_ptr->processMouseOffset(xoffset, yoffset);
 }
 
+// Any other input only needs to wake the loop, ImGui chains its own callbacks after these
+void key_callback(GLFWwindow *, int, int, int, int) {
+  if (pacer_ptr)
+    pacer_ptr->notify_input();
+}
+
+void mouse_button_callback(GLFWwindow *, int, int, int) {
+  if (pacer_ptr)
+    pacer_ptr->notify_input();
+}
+
+void scroll_callback(GLFWwindow *, double, double) {
+  if (pacer_ptr)
+    pacer_ptr->notify_input();
+}
+
+void window_refresh_callback(GLFWwindow *) {
+  if (pacer_ptr)
+    pacer_ptr->notify_input();
+}
+
 int main(int argc, char **argv) {
   int mode = 0;
   bool print_fps = false;
 
   if (argc < 4) {
-    std::cout << "usage: ./main (obj_file) (GL_POINTS or GL_TRIANGLES or GL_LINES) (distance) (optional: fps)\n";
+    print_usage();
     return 0;
   }
 
@@ -83,8 +165,53 @@ int main(int argc, char **argv) {
     return 0;
   }
 
-  if (argc == 5)
-    print_fps = true;
+  std::string record_path, replay_path, replay_report_path;
+  bool obj_occluder = false;
+  std::vector<std::pair<size_t, std::string>> screenshots; // frame and file
+  for (int i = 4; i < argc; i++) {
+    std::string_view arg(argv[i]);
+    bool takes_file = arg == "--record" || arg == "--replay" || arg == "--replay-report";
+    if (takes_file && i + 1 >= argc) {
+      std::cout << "Missing FILE after " << arg << '\n';
+      print_usage();
+      return 0;
+    }
+
+    if (i == 4 && arg == "fps")
+      print_fps = true;
+    else if (arg == "--record")
+      record_path = argv[++i];
+    else if (arg == "--screenshot") {
+      size_t frame;
+      if (i + 2 >= argc || !parse_frame_number(argv[i + 1], frame)) {
+        std::cout << "Invalid --screenshot, N must be a frame number followed by a file\n";
+        print_usage();
+        return 0;
+      }
+      screenshots.emplace_back(frame, argv[i + 2]);
+      i += 2;
+    }
+    else if (arg == "--replay")
+      replay_path = argv[++i];
+    else if (arg == "--replay-report")
+      replay_report_path = argv[++i];
+    else if (arg == "--occluder")
+      obj_occluder = true;
+    else {
+      std::cout << "Unknown argument: " << arg << '\n';
+      print_usage();
+      return 0;
+    }
+  }
+
+  CameraPath camera_path;
+  if (!replay_path.empty()) {
+    if (!camera_path.load(replay_path)) {
+      std::cout << "Couldn't load camera path: " << replay_path << '\n';
+      return 0;
+    }
+    replaying = true;
+  }
 
   float distance = std::stof(argv[3]);
 
@@ -120,12 +247,31 @@ int main(int argc, char **argv) {
   glViewport(0, 0, screenWidth, screenHeight);
   glEnable(GL_DEPTH_TEST);
 
-  vec3 start_pos = {0.0f, 0.0f, 3.0f};
+  math::Vec3 start_pos = {0.0f, 0.0f, 3.0f};
   Camera camera(start_pos);
   camera_ptr = &camera;
 
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  FramePacer pacer;
+  pacer_ptr = &pacer;
+
+  // Replays render every frame as fast as possible so their timings measure the engine
+  ReplayReport replay_report;
+  size_t replay_frame = 0;
+  if (replaying) {
+    pacer.on_demand = false;
+    pacer.target_fps = 0;
+    replay_report.reserve(camera_path.frames.size());
+  }
+
   glfwSetCursorPosCallback(window, mouse_callback);
+  glfwSetKeyCallback(window, key_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
+  glfwSetScrollCallback(window, scroll_callback);
+  glfwSetWindowRefreshCallback(window, window_refresh_callback);
+
+  static Subsystem imgui_subsystem = Subsystem::Gui;
+  ImGui::SetAllocatorFunctions(AllocationTracker::tracked_malloc, AllocationTracker::tracked_free, &imgui_subsystem);
 
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -135,62 +281,182 @@ int main(int argc, char **argv) {
   ImGui_ImplGlfw_InitForOpenGL(window, true);
   ImGui_ImplOpenGL3_Init("#version 330");
 
-  Renderer renderer("shaders/shader.vert", "shaders/shader.frag", screenWidth, screenHeight, mode, distance);
+  // Per frame scratch, released at the start of every loop iteration
+  FrameArena frame_arena;
+  Renderer renderer("shaders/shader.vert", "shaders/shader.frag", screenWidth, screenHeight, mode, distance, frame_arena);
+
+  // A .pages file (see tools/pack_pages.cpp) is streamed around the camera instead of loaded whole
+  PagedGeometry paged;
+  AssetRegistry assets;
+  PointCloud point_cloud;
+  SceneGraph scene;
+  std::string_view input_path(argv[1]);
+  if (input_path.size() > 6 && input_path.substr(input_path.size() - 6) == ".pages") {
+    if (!paged.open(argv[1], mode == GL_LINES)) {
+      std::cout << "Couldn't open pages file: " << argv[1] << '\n';
+      glfwTerminate();
+      return 0;
+    }
+    renderer.paged = &paged;
+  } else if (input_path.size() > 6 && input_path.substr(input_path.size() - 6) == ".scene") {
+    std::string error;
+    std::optional<std::vector<SceneNodeDesc>> nodes = load_scene_file(input_path, error);
+    if (!nodes) {
+      std::cout << "Couldn't load scene: " << error << '\n';
+      glfwTerminate();
+      return 0;
+    }
 
-  std::optional<Model> model = load_obj(argv[1]);
-  if (!model.has_value()) {
-    std::cout << "Couldn't load file: " << argv[1] << '\n';
-    glfwTerminate();
-    return 0;
-  }
-  renderer.add_model(std::move(model.value()));
-
-  // Stats widget
-  class StatsWidget : public GUI::Widget {
-  public:
-    double &fps;
-    double &time;
-    int &ticks;
-    StatsWidget(double &fps_, double &time_, int &ticks_)
-        : fps(fps_), time(time_), ticks(ticks_) {}
-    void Render() override {
-      ImGui::Text("FPS: %.1f", fps);
-      ImGui::Text("Time: %.2f", time);
-      ImGui::Text("Ticks: %d", ticks);
+    // Every model file is parsed once, in parallel, however many nodes use it
+    std::vector<std::string> paths;
+    std::vector<AssetRegistry::LoadOptions> options;
+    std::vector<uint32_t> model_nodes;
+    for (uint32_t i = 0; i < nodes->size(); i++) {
+      const SceneNodeDesc &node = (*nodes)[i];
+      if (node.model.empty())
+        continue;
+      AssetRegistry::LoadOptions node_options;
+      node_options.keep_cpu_mesh = node.occluder;
+      node_options.build_bvh = true;
+      node_options.build_edges = mode == GL_LINES;
+      paths.push_back(node.model);
+      options.push_back(node_options);
+      model_nodes.push_back(i);
+    }
+    std::vector<AssetHandle> handles;
+    {
+      AllocationTracker::Scope scope(Subsystem::Loader);
+      handles = assets.load_all(paths, options);
+    }
+
+    std::vector<Model *> node_models(nodes->size(), nullptr);
+    for (size_t i = 0; i < handles.size(); i++) {
+      if (!handles[i].valid()) {
+        std::cout << "Couldn't load file: " << paths[i] << '\n';
+        glfwTerminate();
+        return 0;
+      }
+      Model model = std::move(*assets.instantiate(handles[i]));
+      model.occluder = (*nodes)[model_nodes[i]].occluder;
+      renderer.add_model(std::move(model));
+      node_models[model_nodes[i]] = renderer.models.back().get();
     }
-  };
-
-  // Console widget
-  class ConsoleWidget : public GUI::Widget {
-  public:
-    std::vector<std::string> logs;
-    void AddLog(const std::string &log) { logs.push_back(log); }
-    void Render() override {
-      ImGui::BeginChild("ConsoleRegion", ImVec2(0, 150), true);
-      for (const auto &log : logs)
-        ImGui::TextUnformatted(log.c_str());
-      ImGui::EndChild();
+
+    scene.build(*nodes);
+    for (uint32_t i = 0; i < scene.size(); i++)
+      scene.attach(i, node_models[scene.source(i)]);
+    scene.update();
+  } else if (mode == GL_POINTS) {
+    // Points only need the vertex list, which can be far larger than a Mesh can index. No Model is
+    // loaded, so there is nothing to pick in this mode
+    std::vector<math::Vec3> points;
+    bool loaded;
+    {
+      AllocationTracker::Scope scope(Subsystem::Loader);
+      loaded = load_obj_positions(argv[1], points) && !points.empty();
+      if (loaded)
+        point_cloud.build(points);
+    }
+    if (!loaded) {
+      std::cout << "Couldn't load file: " << argv[1] << '\n';
+      glfwTerminate();
+      return 0;
+    }
+    renderer.point_cloud = &point_cloud;
+  } else {
+    AssetHandle asset;
+    {
+      AllocationTracker::Scope scope(Subsystem::Loader);
+      AssetRegistry::LoadOptions options;
+      options.build_bvh = true;
+      options.build_edges = mode == GL_LINES;
+      options.keep_cpu_mesh = obj_occluder;
+      asset = assets.load(argv[1], options);
     }
-  };
+    if (!asset.valid()) {
+      std::cout << "Couldn't load file: " << argv[1] << '\n';
+      glfwTerminate();
+      return 0;
+    }
+    Model model = std::move(*assets.instantiate(asset));
+    model.occluder = obj_occluder;
+    renderer.add_model(std::move(model));
+  }
 
-  double fps_val = 0.0;
+  FrameStats frame_stats;
+  AllocationTracker alloc_tracker;
   double time_val = 0.0;
   int ticks = 0;
 
   GUI::Menu left_menu("Game engine menu");
-  auto stats_widget = std::make_shared<StatsWidget>(fps_val, time_val, ticks);
+  auto stats_widget = std::make_shared<GUI::StatsWidget>(frame_stats, time_val, ticks);
   left_menu.AddWidget(stats_widget);
-
-  ConsoleWidget console_widget;
-  GUI::Menu bottom_console("Console", nullptr);
-  bottom_console.AddWidget(std::make_shared<ConsoleWidget>(console_widget));
+  left_menu.AddWidget(std::make_shared<GUI::AllocationWidget>(alloc_tracker, frame_arena));
+  left_menu.AddWidget(std::make_shared<GUI::CullingWidget>(renderer));
+  left_menu.AddWidget(std::make_shared<GUI::CollisionWidget>(renderer));
+  left_menu.AddWidget(std::make_shared<GUI::DynamicGeometryWidget>(renderer));
+  left_menu.AddWidget(std::make_shared<GUI::AssetWidget>(assets));
+  if (paged.is_open())
+    left_menu.AddWidget(std::make_shared<GUI::PagingWidget>(paged));
+  if (renderer.point_cloud)
+    left_menu.AddWidget(std::make_shared<GUI::PointCloudWidget>(point_cloud));
+  if (scene.size())
+    left_menu.AddWidget(std::make_shared<GUI::SceneWidget>(scene));
+  auto pick_widget = std::make_shared<GUI::PickWidget>(renderer);
+  left_menu.AddWidget(pick_widget);
+
+  GUI::ConsoleWidget console_widget;
+
+  time_val = glfwGetTime();
+
+  math::Mat4 last_view{};
+  bool view_changed = false; // in the last frame, the camera may still be gliding
+  bool scene_dirty = true;
+  bool vsync = false;
+
+  // Screenshots are read back over the next frames and written by a background thread
+  FrameCapture frame_capture;
+  size_t drawn_frames = 0;
+  int screenshot_count = 0;
+
+  // Procedural surface rewritten every frame, to exercise the dynamic geometry path
+  std::optional<WaveSurface> wave_surface;
+  bool wave_demo = false;
+  float wave_time = 0.0f;
 
   while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
+    // Pace before polling so input is sampled as late as possible
+    pacer.limit();
+    // A held movement key sends no further events, so it has to keep the loop awake by itself
+    bool camera_moving = camera_mode && camera.isMoving(window);
+    bool was_idle = pacer.poll_events(scene_dirty || view_changed || camera_moving || console_widget.HasPending() ||
+                                      paged.busy() || frame_capture.busy());
+
+    frame_capture.poll();
+    frame_capture.messages().drain([&](std::string_view message) { console_widget.AddLog(message); });
+
+    frame_arena.reset();
 
     double currentFrame = glfwGetTime();
     float delta_time = static_cast<float>(currentFrame - time_val);
     time_val = currentFrame;
+    if (was_idle) {
+      // Time spent blocked isn't frame time, and would make the camera jump
+      delta_time = 0.0f;
+    } else {
+      frame_stats.add_frame(delta_time);
+    }
+
+    if (replaying) {
+      // The first frame's time includes startup, every later one is a replayed frame
+      if (replay_frame > 0)
+        replay_report.add_frame(delta_time * 1000.0f);
+      if (replay_frame == camera_path.frames.size()) {
+        glfwSetWindowShouldClose(window, true);
+        break;
+      }
+      delta_time = camera_path.timestep;
+    }
 
     if (ImGui::IsKeyPressed(ImGuiKey_Escape)) {
       if (camera_mode) {
@@ -203,15 +469,86 @@ int main(int argc, char **argv) {
       }
     }
 
-    if (camera_mode)
+    if (replaying)
+      camera_path.apply(replay_frame++, camera);
+    else if (camera_mode)
       camera.processKeyboard(window, delta_time);
 
+    // Replays already hold the collided positions
+    if (renderer.camera_collision && !replaying && !renderer.models.empty()) {
+      renderer.update_collision();
+      camera.position = renderer.collide_camera(camera.position);
+    }
+
     camera.updateViewMatrix();
 
+    view_changed = last_view != camera.view_matrix;
+    if (view_changed) {
+      last_view = camera.view_matrix;
+      scene_dirty = true;
+    }
+    if (renderer.update(delta_time))
+      scene_dirty = true;
+    if (scene.update())
+      scene_dirty = true;
+    if (wave_surface) {
+      wave_time += delta_time;
+      wave_surface->update(wave_time);
+      scene_dirty = true;
+    }
+    if (paged.is_open()) {
+      AllocationTracker::Scope scope(Subsystem::Loader);
+      if (paged.update(camera.position, delta_time))
+        scene_dirty = true;
+    }
+
+    if (!pacer.needs_frame(scene_dirty) && !console_widget.HasPending()) {
+      alloc_tracker.end_frame();
+      continue;
+    }
+
+    for (const auto &[frame, file] : screenshots) {
+      if (frame == drawn_frames)
+        frame_capture.request(file);
+    }
+    drawn_frames++;
+
+    if (!record_path.empty()) {
+      uint16_t input = 0;
+      if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input |= InputForward;
+      if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input |= InputBack;
+      if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input |= InputLeft;
+      if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input |= InputRight;
+      if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) input |= InputUp;
+      if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) input |= InputMouseLeft;
+      if (camera_mode) input |= InputCameraMode;
+      camera_path.record(camera, frame_mouse_dx, frame_mouse_dy, input);
+    }
+    frame_mouse_dx = 0.0f;
+    frame_mouse_dy = 0.0f;
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // Pick the triangle under the cursor when the mouse is free and not over the UI
+    if (!camera_mode && ImGui::IsMouseClicked(0) && !io.WantCaptureMouse) {
+      double mouse_x, mouse_y;
+      int window_width, window_height;
+      glfwGetCursorPos(window, &mouse_x, &mouse_y);
+      glfwGetWindowSize(window, &window_width, &window_height);
+
+      math::Vec3 ray_origin, ray_direction;
+      renderer.screen_ray(static_cast<float>(2.0 * mouse_x / window_width - 1.0),
+                          static_cast<float>(1.0 - 2.0 * mouse_y / window_height), ray_origin, ray_direction);
+
+      auto pick_start = std::chrono::steady_clock::now();
+      std::optional<PickResult> pick = renderer.pick(ray_origin, ray_direction);
+      double pick_us =
+          std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - pick_start).count();
+      pick_widget->SetResult(pick, pick_us);
+    }
+
     // Top menu bar
     if (ImGui::BeginMainMenuBar()) {
       if (ImGui::BeginMenu("Camera")) {
@@ -226,7 +563,36 @@ int main(int argc, char **argv) {
         ImGui::EndMenu();
       }
       if (ImGui::BeginMenu("Settings")) {
-        ImGui::MenuItem("Placeholder", NULL, false, false);
+        ImGui::MenuItem("On-demand rendering", NULL, &pacer.on_demand);
+        if (ImGui::MenuItem("Animate model", NULL, &renderer.animate))
+          scene_dirty = true;
+        if (ImGui::MenuItem("Occlusion culling", NULL, &renderer.occlusion_culling))
+          scene_dirty = true;
+        ImGui::MenuItem("Camera collision", NULL, &renderer.camera_collision);
+        if (ImGui::MenuItem("Dynamic geometry demo", NULL, &wave_demo)) {
+          renderer.dynamic_meshes.clear();
+          wave_surface.reset();
+          if (wave_demo) {
+            wave_surface.emplace();
+            renderer.dynamic_meshes.push_back(&wave_surface->mesh());
+          }
+          scene_dirty = true;
+        }
+        if (ImGui::MenuItem("VSync", NULL, &vsync))
+          glfwSwapInterval(vsync ? 1 : 0);
+        ImGui::SliderInt("Target FPS", &pacer.target_fps, 0, 240, pacer.target_fps ? "%d" : "unlimited");
+        ImGui::EndMenu();
+      }
+      if (ImGui::BeginMenu("Capture")) {
+        char file[64];
+        if (ImGui::MenuItem("Screenshot (PNG)")) {
+          std::snprintf(file, sizeof(file), "screenshot_%03d.png", screenshot_count++);
+          frame_capture.request(file);
+        }
+        if (ImGui::MenuItem("Screenshot (PPM)")) {
+          std::snprintf(file, sizeof(file), "screenshot_%03d.ppm", screenshot_count++);
+          frame_capture.request(file);
+        }
         ImGui::EndMenu();
       }
       ImGui::EndMainMenuBar();
@@ -236,30 +602,57 @@ int main(int argc, char **argv) {
     left_menu.Render();
 
     // Render bottom console window
-    ImGui::SetNextWindowPos(ImVec2(0, io.DisplaySize.y - 150));
-    ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x, 150));
-    ImGuiWindowFlags console_flags =
-        ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse;
-    ImGui::Begin("Console", nullptr, console_flags);
     console_widget.Render();
-    ImGui::End();
 
-    // Render OpenGL scene
-    renderer.setViewMatrix(&camera.view_matrix[0][0]);
-    renderer.draw_models();
+    // Render OpenGL scene, or show the previous one again if nothing in it changed
+    {
+      AllocationTracker::Scope scope(Subsystem::Renderer);
+      if (scene_dirty) {
+        renderer.setViewMatrix(camera.view_matrix);
+        renderer.draw_models();
+        scene_dirty = false;
+      }
+      // The scene without the UI, read back over the next frames
+      frame_capture.capture(renderer.scene_fbo, renderer.width, renderer.height);
+      renderer.present();
+    }
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     glfwSwapBuffers(window);
+    pacer.frame_presented();
 
     if (print_fps) {
-      fps_val = 1.0 / delta_time;
       ticks++;
-      std::ostringstream oss;
-      oss << "FPS: " << fps_val << ", Time: " << time_val << ", Ticks: " << ticks;
-      console_widget.AddLog(oss.str());
+      FrameStats::Summary summary = frame_stats.summary();
+      char line[128];
+      int length = std::snprintf(line, sizeof(line), "FPS: %.1f, Time: %.2f, Ticks: %d, p99: %.2f ms",
+                                 summary.avg_ms > 0.0f ? 1000.0f / summary.avg_ms : 0.0f, time_val, ticks,
+                                 summary.p99_ms);
+      console_widget.AddLog(std::string_view(line, std::min<size_t>(length, sizeof(line) - 1)));
     }
+
+    alloc_tracker.end_frame();
+  }
+
+  // Stops the page loader and frees page buffers while the context still exists
+  paged.close();
+  renderer.dynamic_meshes.clear();
+  wave_surface.reset();
+  frame_capture.close();
+  frame_capture.messages().drain([](std::string_view message) { std::cout << message << '\n'; });
+
+  if (!record_path.empty()) {
+    if (camera_path.save(record_path))
+      std::cout << "Recorded " << camera_path.frames.size() << " frames to " << record_path << '\n';
+    else
+      std::cout << "Couldn't write camera path: " << record_path << '\n';
+  }
+  if (replaying) {
+    std::cout << replay_report.summary() << '\n';
+    if (!replay_report_path.empty() && !replay_report.write_csv(replay_report_path))
+      std::cout << "Couldn't write replay report: " << replay_report_path << '\n';
   }
 
   ImGui_ImplOpenGL3_Shutdown();
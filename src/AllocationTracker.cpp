@@ -0,0 +1,18 @@
+#include "AllocationTracker.hpp"
+
+// The replacement operators live in their own translation unit so no include order can leave
+// them out; linking this file is what turns allocation tracking on.
+
+void *operator new(std::size_t size)
+{
+	AllocationTracker::record(size);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * @brief Parts of the engine heap allocations are attributed to
+ *
+ */
+enum class Subsystem : uint8_t
+{
+	General,
+	Loader,
+	Renderer,
+	Gui,
+	Count
+};
+
+inline const char *subsystem_name(Subsystem s)
+{
+	switch (s)
+	{
+	case Subsystem::General: return "General";
+	case Subsystem::Loader: return "Loader";
+	case Subsystem::Renderer: return "Renderer";
+	case Subsystem::Gui: return "GUI";
+	default: return "?";
+	}
+}
+
+/**
+ * @brief Counts heap allocations per subsystem. The global operator new in AllocationTracker.cpp
+ * feeds it when that file is linked in; the subsystem is whichever AllocationTracker::Scope is
+ * active on the calling thread.
+ *
+ */
+class AllocationTracker
+{
+public:
+	static constexpr size_t subsystem_count = static_cast<size_t>(Subsystem::Count);
+
+	struct Counts
+	{
+		std::array<uint64_t, subsystem_count> allocations{};
+		std::array<uint64_t, subsystem_count> bytes{};
+
+		uint64_t total_allocations() const
+		{
+			uint64_t total = 0;
+			for (uint64_t a : allocations)
+				total += a;
+			return total;
+		}
+
+		uint64_t total_bytes() const
+		{
+			uint64_t total = 0;
+			for (uint64_t b : bytes)
+				total += b;
+			return total;
+		}
+	};
+
+	/**
+	 * @brief Attributes allocations on this thread to a subsystem for the lifetime of the scope
+	 *
+	 */
+	class Scope
+	{
+		Subsystem m_previous;
+
+	    public:
+		Scope(Subsystem s) : m_previous(current()) { current() = s; }
+		~Scope() { current() = m_previous; }
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+	static Subsystem &current()
+	{
+		static thread_local Subsystem subsystem = Subsystem::General;
+		return subsystem;
+	}
+
+	static void record(size_t bytes) { record(bytes, current()); }
+
+	static void record(size_t bytes, Subsystem subsystem)
+	{
+		size_t index = static_cast<size_t>(subsystem);
+		s_allocations[index].fetch_add(1, std::memory_order_relaxed);
+		s_bytes[index].fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Running totals since startup
+	 *
+	 */
+	static Counts totals()
+	{
+		Counts c;
+		for (size_t i = 0; i < subsystem_count; i++)
+		{
+			c.allocations[i] = s_allocations[i].load(std::memory_order_relaxed);
+			c.bytes[i] = s_bytes[i].load(std::memory_order_relaxed);
+		}
+		return c;
+	}
+
+	/**
+	 * @brief Closes the current frame, last_frame() then holds what it allocated
+	 *
+	 */
+	void end_frame()
+	{
+		Counts now = totals();
+		for (size_t i = 0; i < subsystem_count; i++)
+		{
+			m_last_frame.allocations[i] = now.allocations[i] - m_frame_start.allocations[i];
+			m_last_frame.bytes[i] = now.bytes[i] - m_frame_start.bytes[i];
+		}
+		m_frame_start = now;
+	}
+
+	const Counts &last_frame() const { return m_last_frame; }
+
+	/**
+	 * @brief malloc-style hooks for libraries with their own allocator callbacks (ImGui::SetAllocatorFunctions).
+	 * user_data may point at the Subsystem to charge, otherwise the current scope is used
+	 *
+	 */
+	static void *tracked_malloc(size_t bytes, void *user_data)
+	{
+		record(bytes, user_data ? *static_cast<Subsystem *>(user_data) : current());
+		return std::malloc(bytes);
+	}
+
+	static void tracked_free(void *ptr, void *) { std::free(ptr); }
+
+    private:
+	static inline std::array<std::atomic<uint64_t>, subsystem_count> s_allocations{};
+	static inline std::array<std::atomic<uint64_t>, subsystem_count> s_bytes{};
+
+	Counts m_frame_start;
+	Counts m_last_frame;
+};
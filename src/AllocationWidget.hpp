@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AllocationTracker.hpp"
+#include "FrameArena.hpp"
+#include "Menu.hpp"
+
+namespace GUI {
+
+    class AllocationWidget : public Widget {
+    public:
+        AllocationWidget(const AllocationTracker& tracker, const FrameArena& arena)
+            : m_Tracker(tracker), m_Arena(arena) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Allocations"))
+                return;
+
+            const AllocationTracker::Counts& frame = m_Tracker.last_frame();
+            AllocationTracker::Counts totals = AllocationTracker::totals();
+
+            ImGui::Text("Last frame: %llu allocs, %.1f KB",
+                        static_cast<unsigned long long>(frame.total_allocations()),
+                        frame.total_bytes() / 1024.0);
+
+            for (size_t i = 0; i < AllocationTracker::subsystem_count; i++) {
+                ImGui::Text("%-9s %6llu / frame %8.1f KB / frame %10llu total",
+                            subsystem_name(static_cast<Subsystem>(i)),
+                            static_cast<unsigned long long>(frame.allocations[i]),
+                            frame.bytes[i] / 1024.0,
+                            static_cast<unsigned long long>(totals.allocations[i]));
+            }
+
+            ImGui::Text("Frame arena: %.1f / %.1f KB (peak %.1f KB)",
+                        m_Arena.last_frame_used() / 1024.0, m_Arena.capacity() / 1024.0,
+                        m_Arena.high_water() / 1024.0);
+        }
+
+    private:
+        const AllocationTracker& m_Tracker;
+        const FrameArena& m_Arena;
+    };
+
+}
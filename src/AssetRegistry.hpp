@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "Model.hpp"
+#include "load_obj.hpp"
+
+/**
+ * @brief Refers to an asset loaded by an AssetRegistry, stays invalid after the asset is unloaded
+ *
+ */
+struct AssetHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != UINT32_MAX; }
+    bool operator==(const AssetHandle &o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const AssetHandle &o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Loads every model file once and hands out models that share its GPU buffers.
+ *
+ * Each path is loaded, uploaded and (optionally) given a BVH the first time it is requested;
+ * later loads of the same path return the same handle and bump its reference count. Models
+ * drawn in the scene are instances of the registry's copy, so the GPU buffers live until the
+ * asset is released and no instance uses them anymore. The CPU copy of the mesh is freed after
+ * upload unless asked for.
+ *
+ */
+class AssetRegistry
+{
+public:
+    struct LoadOptions
+    {
+        bool keep_cpu_mesh = false; // needed by occluders
+        bool build_bvh = false;
+        bool build_edges = false; // for GL_LINES
+    };
+
+    struct AssetInfo
+    {
+        std::string_view path; // valid until the registry loads or releases something
+        AssetHandle handle;
+        uint32_t refs;
+        long instances; // models currently drawing the asset's buffers, besides the registry
+        size_t vertices;
+        size_t indices;
+        size_t edges; // unique edges drawn in GL_LINES mode, 0 if not built
+        size_t cpu_bytes;
+        size_t gpu_bytes;
+        bool cpu_mesh;         // kept for occluders
+        bool cpu_mesh_missing; // asked for after it was released, but the file couldn't be parsed again
+        uint32_t cpu_mesh_reloads; // times the file was parsed again for a request needing the CPU mesh
+    };
+
+private:
+    struct Entry
+    {
+        std::string path;
+        std::optional<Model> model;
+        uint32_t generation = 0;
+        uint32_t refs = 0;
+        bool cpu_mesh_missing = false;
+        uint32_t cpu_mesh_reloads = 0;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_free;
+    std::unordered_map<std::string, uint32_t> m_by_path;
+
+    Entry *find(AssetHandle handle)
+    {
+        if (handle.index >= m_entries.size())
+            return nullptr;
+        Entry &entry = m_entries[handle.index];
+        return entry.model && entry.generation == handle.generation ? &entry : nullptr;
+    }
+
+    /**
+     * @brief Parses the file again for a request needing the CPU mesh after it was released
+     *
+     * The GPU buffers are kept, the mesh only has to match them.
+     */
+    bool reload_cpu_mesh(Entry &entry)
+    {
+        std::optional<Mesh> mesh = load_obj_mesh(entry.path);
+        entry.cpu_mesh_reloads++;
+        return mesh && entry.model->restore_cpu_mesh(std::move(*mesh));
+    }
+
+    AssetHandle add(std::string_view path, Model model, const LoadOptions &options)
+    {
+        if (options.build_bvh)
+            model.build_bvh();
+        if (options.build_edges)
+            model.build_edges();
+        if (!options.keep_cpu_mesh)
+            model.release_cpu_mesh();
+
+        uint32_t index;
+        if (!m_free.empty())
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_entries.size());
+            m_entries.emplace_back();
+        }
+
+        Entry &entry = m_entries[index];
+        entry.path = std::string(path);
+        entry.model.emplace(std::move(model));
+        entry.refs = 1;
+        entry.cpu_mesh_missing = false;
+        entry.cpu_mesh_reloads = 0;
+        m_by_path[entry.path] = index;
+        return {index, entry.generation};
+    }
+
+public:
+    /**
+     * @brief Loads the file if it isn't loaded yet, an invalid handle if it couldn't be loaded
+     *
+     * A loaded file whose CPU mesh was released is parsed again when this request needs it. If
+     * that fails the handle is still valid and drawable, report() shows the asset without its mesh.
+     */
+    AssetHandle load(std::string_view path, const LoadOptions &options)
+    {
+        auto found = m_by_path.find(std::string(path));
+        if (found != m_by_path.end())
+        {
+            Entry &entry = m_entries[found->second];
+            Model &model = *entry.model;
+            entry.refs++;
+            bool build_bvh = options.build_bvh && !model.bvh;
+            bool build_edges = options.build_edges && !model.edge_index_count();
+            bool had_cpu_mesh = model.has_cpu_mesh();
+            if (!had_cpu_mesh && (options.keep_cpu_mesh || build_bvh || build_edges) && !reload_cpu_mesh(entry))
+            {
+                entry.cpu_mesh_missing |= options.keep_cpu_mesh;
+                return {found->second, entry.generation};
+            }
+            if (options.keep_cpu_mesh)
+                entry.cpu_mesh_missing = false;
+            if (build_bvh)
+                model.build_bvh();
+            if (build_edges)
+                model.build_edges();
+            if (!had_cpu_mesh && !options.keep_cpu_mesh)
+                model.release_cpu_mesh(); // only parsed again for the builds
+            return {found->second, entry.generation};
+        }
+
+        std::optional<Model> model = load_obj(path);
+        if (!model)
+            return {};
+        return add(path, std::move(*model), options);
+    }
+
+    AssetHandle load(std::string_view path) { return load(path, LoadOptions()); }
+
+    /**
+     * @brief Loads many files at once, parsing the ones not loaded yet in parallel
+     *
+     * Parsing is the slow part and doesn't touch OpenGL, so only the upload and the optional BVH
+     * and edge builds run on the calling thread. Every path takes one reference, like load(), and
+     * a path listed more than once is parsed once with its options combined. Paths loaded before
+     * go through load(), which parses them again if they need a CPU mesh that was released.
+     *
+     * @param paths The files to load
+     * @param options One entry per path
+     * @return One handle per path, invalid where the file couldn't be loaded
+     */
+    std::vector<AssetHandle> load_all(const std::vector<std::string> &paths, const std::vector<LoadOptions> &options,
+                                      JobSystem &jobs = JobSystem::shared())
+    {
+        // Files to parse, each with the options of every request for it
+        std::vector<std::string_view> pending;
+        std::vector<LoadOptions> pending_options;
+        std::unordered_map<std::string_view, size_t> pending_index;
+        std::vector<bool> first_request(paths.size(), false); // gets the reference taken when adding
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (m_by_path.count(paths[i]))
+                continue;
+            auto [it, inserted] = pending_index.try_emplace(paths[i], pending.size());
+            if (inserted)
+            {
+                pending.push_back(paths[i]);
+                pending_options.push_back(options[i]);
+                first_request[i] = true;
+                continue;
+            }
+            LoadOptions &combined = pending_options[it->second];
+            combined.keep_cpu_mesh |= options[i].keep_cpu_mesh;
+            combined.build_bvh |= options[i].build_bvh;
+            combined.build_edges |= options[i].build_edges;
+        }
+
+        std::vector<std::optional<Mesh>> meshes(pending.size());
+        jobs.parallel_for(0, pending.size(), 1, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+                meshes[i] = load_obj_mesh(pending[i]);
+        });
+
+        std::vector<AssetHandle> handles(paths.size());
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            if (meshes[i])
+                add(pending[i], Model(std::move(*meshes[i])), pending_options[i]);
+        }
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            auto found = m_by_path.find(paths[i]);
+            if (found == m_by_path.end())
+                continue; // couldn't be parsed
+            if (first_request[i])
+                handles[i] = {found->second, m_entries[found->second].generation};
+            else
+                handles[i] = load(paths[i], options[i]);
+        }
+        return handles;
+    }
+
+    /**
+     * @brief Drops one reference, the registry's copy is freed with the last one
+     *
+     * Instances made from the asset keep its GPU buffers alive until they are destroyed too.
+     */
+    void release(AssetHandle handle)
+    {
+        Entry *entry = find(handle);
+        if (!entry || --entry->refs > 0)
+            return;
+
+        m_by_path.erase(entry->path);
+        entry->path.clear();
+        entry->model.reset();
+        entry->generation++;
+        m_free.push_back(handle.index);
+    }
+
+    /**
+     * @brief The registry's own copy of the asset, nullptr for a stale handle
+     *
+     */
+    const Model *get(AssetHandle handle)
+    {
+        Entry *entry = find(handle);
+        return entry ? &*entry->model : nullptr;
+    }
+
+    /**
+     * @brief A model drawing the asset's GPU buffers with its own transform
+     *
+     */
+    std::optional<Model> instantiate(AssetHandle handle)
+    {
+        std::optional<Model> result;
+        if (Entry *entry = find(handle))
+            result.emplace(entry->model->instance());
+        return result;
+    }
+
+    /**
+     * @brief Memory use of every loaded asset, reusing the storage of result
+     *
+     */
+    void report(std::vector<AssetInfo> &result) const
+    {
+        result.clear();
+        for (uint32_t i = 0; i < m_entries.size(); i++)
+        {
+            const Entry &entry = m_entries[i];
+            if (!entry.model)
+                continue;
+            const Model &model = *entry.model;
+            result.push_back({entry.path, {i, entry.generation}, entry.refs, model.share_count() - 1,
+                              model.vertex_count(), static_cast<size_t>(model.index_count()),
+                              static_cast<size_t>(model.edge_index_count()) / 2, model.cpu_bytes(), model.gpu_bytes(),
+                              model.has_cpu_mesh(), entry.cpu_mesh_missing, entry.cpu_mesh_reloads});
+        }
+    }
+
+    size_t size() const { return m_by_path.size(); }
+};
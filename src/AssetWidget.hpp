@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AssetRegistry.hpp"
+#include "Menu.hpp"
+#include <vector>
+
+namespace GUI {
+
+    class AssetWidget : public Widget {
+    public:
+        AssetWidget(const AssetRegistry& registry) : m_Registry(registry) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Assets"))
+                return;
+
+            m_Registry.report(m_Report);
+            size_t cpu_total = 0, gpu_total = 0;
+            for (const AssetRegistry::AssetInfo& asset : m_Report) {
+                ImGui::Text("%.*s", static_cast<int>(asset.path.size()), asset.path.data());
+                ImGui::Text("  refs %u, instances %ld, %zu vertices, %zu indices", asset.refs, asset.instances,
+                            asset.vertices, asset.indices);
+                if (asset.edges)
+                    ImGui::Text("  %zu unique edges, %zu as per-triangle lines", asset.edges, asset.indices);
+                ImGui::Text("  CPU %.1f KB, GPU %.1f KB", asset.cpu_bytes / 1024.0, asset.gpu_bytes / 1024.0);
+                if (asset.cpu_mesh_missing)
+                    ImGui::Text("  CPU mesh released and couldn't be reloaded, not an occluder");
+                else if (asset.cpu_mesh_reloads)
+                    ImGui::Text("  CPU mesh %s, file parsed again %u times", asset.cpu_mesh ? "kept" : "released",
+                                asset.cpu_mesh_reloads);
+                cpu_total += asset.cpu_bytes;
+                gpu_total += asset.gpu_bytes;
+            }
+            ImGui::Separator();
+            ImGui::Text("%zu assets, CPU %.1f KB, GPU %.1f KB", m_Report.size(), cpu_total / 1024.0, gpu_total / 1024.0);
+        }
+
+    private:
+        const AssetRegistry& m_Registry;
+        std::vector<AssetRegistry::AssetInfo> m_Report; // reused every frame
+    };
+
+}
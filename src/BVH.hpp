@@ -0,0 +1,523 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "Math.hpp"
+#include "Mesh.hpp"
+
+/**
+ * @brief One node of a BVH. Interior nodes have count == 0 and their children at first and first + 1,
+ * leaves own the triangles [first, first + count)
+ *
+ */
+struct BVHNode
+{
+    math::AABB bounds;
+    uint32_t first;
+    uint32_t count;
+};
+
+/**
+ * @brief Bounding volume hierarchy over the triangles of a mesh, for ray casts and closest point queries.
+ *
+ * Built top-down with a binned surface area heuristic; large subtrees are built on the job system.
+ * Nodes live in one flat array with siblings next to each other, and the triangles are copied out
+ * of the mesh in leaf order, so a query walks memory mostly forwards.
+ *
+ */
+class BVH
+{
+public:
+    struct RayHit
+    {
+        float t;           // distance along the ray in units of its direction's length
+        uint32_t triangle; // index of the triangle in the mesh's index list (indices[3 * triangle])
+        float u, v;        // barycentrics of the hit relative to the triangle's 2nd and 3rd vertex
+    };
+
+    struct ClosestHit
+    {
+        math::Vec3 point;
+        float distance_sq;
+        uint32_t triangle;
+    };
+
+    static constexpr uint32_t max_leaf_size = 4;
+    static constexpr int bin_count = 16;
+    static constexpr uint32_t parallel_threshold = 4096; // triangles below which a subtree is built inline
+    static constexpr uint32_t max_depth = 48;            // keeps the fixed query stacks from overflowing
+
+private:
+    struct Triangle
+    {
+        math::Vec3 v0, v1, v2;
+    };
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<Triangle> m_triangles;
+    std::vector<uint32_t> m_triangle_ids;
+    uint32_t m_depth = 0;
+    double m_build_ms = 0.0;
+
+    // Build state, only valid during construction
+    struct BuildData
+    {
+        std::vector<math::AABB> bounds;
+        std::vector<math::Vec3> centroids;
+        std::vector<uint32_t> order;
+        std::atomic<uint32_t> node_count{1};
+        std::atomic<uint32_t> depth{0};
+    };
+
+    static float area(const math::AABB &b)
+    {
+        math::Vec3 d = b.max - b.min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    static math::AABB empty_box()
+    {
+        return {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+    }
+
+    static void grow(math::AABB &box, const math::AABB &other)
+    {
+        box.min = math::min(box.min, other.min);
+        box.max = math::max(box.max, other.max);
+    }
+
+    void build_node(BuildData &data, uint32_t node_index, uint32_t begin, uint32_t end, uint32_t depth,
+                    JobSystem::TaskGroup &group)
+    {
+        BVHNode &node = m_nodes[node_index];
+        math::AABB centroid_bounds = empty_box();
+        node.bounds = empty_box();
+        for (uint32_t i = begin; i < end; i++)
+        {
+            grow(node.bounds, data.bounds[data.order[i]]);
+            const math::Vec3 &c = data.centroids[data.order[i]];
+            grow(centroid_bounds, {c, c});
+        }
+
+        uint32_t count = end - begin;
+        uint32_t prev_depth = data.depth.load(std::memory_order_relaxed);
+        while (depth > prev_depth && !data.depth.compare_exchange_weak(prev_depth, depth))
+        {
+        }
+
+        auto make_leaf = [&] {
+            node.first = begin;
+            node.count = count;
+        };
+
+        if (count <= max_leaf_size || depth >= max_depth)
+        {
+            make_leaf();
+            return;
+        }
+
+        // Binned SAH: try bin boundaries on every axis, keep the cheapest split
+        int best_axis = -1;
+        int best_split = 0;
+        float best_cost = INFINITY;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float cmin = centroid_bounds.min[axis];
+            float extent = centroid_bounds.max[axis] - cmin;
+            if (extent <= 0.0f)
+                continue;
+            float scale = bin_count / extent;
+
+            uint32_t bin_counts[bin_count] = {};
+            math::AABB bin_bounds[bin_count];
+            for (auto &b : bin_bounds)
+                b = empty_box();
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                uint32_t tri = data.order[i];
+                int bin = std::min(bin_count - 1, static_cast<int>((data.centroids[tri][axis] - cmin) * scale));
+                bin_counts[bin]++;
+                grow(bin_bounds[bin], data.bounds[tri]);
+            }
+
+            // Sweep from the right to get the cost of every right side, then from the left
+            float right_area[bin_count];
+            uint32_t right_count[bin_count];
+            math::AABB acc = empty_box();
+            uint32_t acc_count = 0;
+            for (int b = bin_count - 1; b > 0; b--)
+            {
+                grow(acc, bin_bounds[b]);
+                acc_count += bin_counts[b];
+                right_area[b] = acc_count ? area(acc) : 0.0f;
+                right_count[b] = acc_count;
+            }
+
+            acc = empty_box();
+            acc_count = 0;
+            for (int b = 0; b < bin_count - 1; b++)
+            {
+                grow(acc, bin_bounds[b]);
+                acc_count += bin_counts[b];
+                if (acc_count == 0 || right_count[b + 1] == 0)
+                    continue;
+                float cost = acc_count * area(acc) + right_count[b + 1] * right_area[b + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b + 1;
+                }
+            }
+        }
+
+        uint32_t mid;
+        if (best_axis >= 0)
+        {
+            // A leaf is cheaper when intersecting everything beats one more traversal step
+            float leaf_cost = count * area(node.bounds);
+            if (best_cost + area(node.bounds) >= leaf_cost && count <= 4 * max_leaf_size)
+            {
+                make_leaf();
+                return;
+            }
+
+            float cmin = centroid_bounds.min[best_axis];
+            float scale = bin_count / (centroid_bounds.max[best_axis] - cmin);
+            auto split = std::partition(data.order.begin() + begin, data.order.begin() + end, [&](uint32_t tri) {
+                int bin = std::min(bin_count - 1, static_cast<int>((data.centroids[tri][best_axis] - cmin) * scale));
+                return bin < best_split;
+            });
+            mid = static_cast<uint32_t>(split - data.order.begin());
+        }
+        else
+        {
+            // Every centroid is in the same place, splitting by position won't help
+            if (count <= 4 * max_leaf_size)
+            {
+                make_leaf();
+                return;
+            }
+            mid = begin + count / 2;
+        }
+
+        uint32_t left = data.node_count.fetch_add(2, std::memory_order_relaxed);
+        node.first = left;
+        node.count = 0;
+
+        if (mid - begin >= parallel_threshold)
+        {
+            group.run([this, &data, left, begin, mid, depth, &group] {
+                build_node(data, left, begin, mid, depth + 1, group);
+            });
+        }
+        else
+        {
+            build_node(data, left, begin, mid, depth + 1, group);
+        }
+        build_node(data, left + 1, mid, end, depth + 1, group);
+    }
+
+    static bool intersect_box(const math::AABB &box, const math::Vec3 &origin, const math::Vec3 &inv_dir, float t_max,
+                              float &t_enter)
+    {
+        float t0 = 0.0f;
+        float t1 = t_max;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float near_t = (box.min[axis] - origin[axis]) * inv_dir[axis];
+            float far_t = (box.max[axis] - origin[axis]) * inv_dir[axis];
+            if (near_t > far_t)
+                std::swap(near_t, far_t);
+            // NaN (origin on a slab with a zero direction component) leaves the interval as is
+            t0 = near_t > t0 ? near_t : t0;
+            t1 = far_t < t1 ? far_t : t1;
+            if (t0 > t1)
+                return false;
+        }
+        t_enter = t0;
+        return true;
+    }
+
+    // Möller-Trumbore
+    static bool intersect_triangle(const Triangle &tri, const math::Vec3 &origin, const math::Vec3 &dir, float &t,
+                                   float &u, float &v)
+    {
+        math::Vec3 e1 = tri.v1 - tri.v0;
+        math::Vec3 e2 = tri.v2 - tri.v0;
+        math::Vec3 p = math::cross(dir, e2);
+        float det = math::dot(e1, p);
+        if (std::fabs(det) < 1e-12f)
+            return false;
+        float inv_det = 1.0f / det;
+        math::Vec3 s = origin - tri.v0;
+        u = math::dot(s, p) * inv_det;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        math::Vec3 q = math::cross(s, e1);
+        v = math::dot(dir, q) * inv_det;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+        t = math::dot(e2, q) * inv_det;
+        return t > 0.0f;
+    }
+
+    static float box_distance_sq(const math::AABB &box, const math::Vec3 &p)
+    {
+        float d = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float e = std::max({box.min[axis] - p[axis], 0.0f, p[axis] - box.max[axis]});
+            d += e * e;
+        }
+        return d;
+    }
+
+    // Ericson, Real-Time Collision Detection 5.1.5
+    static math::Vec3 closest_on_triangle(const Triangle &tri, const math::Vec3 &p)
+    {
+        const math::Vec3 &a = tri.v0, &b = tri.v1, &c = tri.v2;
+        math::Vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = math::dot(ab, ap), d2 = math::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return a;
+
+        math::Vec3 bp = p - b;
+        float d3 = math::dot(ab, bp), d4 = math::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return b;
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return a + ab * (d1 / (d1 - d3));
+
+        math::Vec3 cp = p - c;
+        float d5 = math::dot(ab, cp), d6 = math::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return c;
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return a + ac * (d2 / (d2 - d6));
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+public:
+    /**
+     * @brief Builds the hierarchy over the mesh's triangles (every 3 indices)
+     *
+     */
+    BVH(const Mesh &mesh, JobSystem &jobs = JobSystem::shared())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        BuildData data;
+        size_t triangle_count = mesh.indices.size() / 3;
+        std::vector<Triangle> triangles;
+        triangles.reserve(triangle_count);
+        std::vector<uint32_t> ids;
+        ids.reserve(triangle_count);
+        for (size_t i = 0; i < triangle_count; i++)
+        {
+            GLushort a = mesh.indices[3 * i], b = mesh.indices[3 * i + 1], c = mesh.indices[3 * i + 2];
+            if (a >= mesh.vertices.size() || b >= mesh.vertices.size() || c >= mesh.vertices.size())
+                continue;
+            auto to_vec = [&](GLushort index) {
+                const auto &p = mesh.vertices[index].position;
+                return math::Vec3{p[0], p[1], p[2]};
+            };
+            triangles.push_back({to_vec(a), to_vec(b), to_vec(c)});
+            ids.push_back(static_cast<uint32_t>(i));
+        }
+
+        uint32_t n = static_cast<uint32_t>(triangles.size());
+        data.bounds.resize(n);
+        data.centroids.resize(n);
+        data.order.resize(n);
+        jobs.parallel_for(0, n, 4096, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+            {
+                const Triangle &t = triangles[i];
+                data.bounds[i] = {math::min(math::min(t.v0, t.v1), t.v2), math::max(math::max(t.v0, t.v1), t.v2)};
+                data.centroids[i] = data.bounds[i].center();
+                data.order[i] = static_cast<uint32_t>(i);
+            }
+        });
+
+        m_nodes.resize(std::max<uint32_t>(1, 2 * n));
+        if (n == 0)
+        {
+            m_nodes[0] = {empty_box(), 0, 0};
+        }
+        else
+        {
+            JobSystem::TaskGroup group(jobs);
+            build_node(data, 0, 0, n, 1, group);
+            group.wait();
+        }
+        m_nodes.resize(data.node_count.load());
+        m_nodes.shrink_to_fit();
+        m_depth = data.depth.load();
+
+        // Store triangles in leaf order
+        m_triangles.resize(n);
+        m_triangle_ids.resize(n);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            m_triangles[i] = triangles[data.order[i]];
+            m_triangle_ids[i] = ids[data.order[i]];
+        }
+
+        m_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Finds the nearest triangle hit by the ray origin + t * dir with 0 < t < t_max
+     *
+     */
+    std::optional<RayHit> raycast(const math::Vec3 &origin, const math::Vec3 &dir, float t_max = INFINITY) const
+    {
+        std::optional<RayHit> hit;
+        math::Vec3 inv_dir = {1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z};
+        float best = t_max;
+
+        float t_enter;
+        if (m_triangles.empty() || !intersect_box(m_nodes[0].bounds, origin, inv_dir, best, t_enter))
+            return hit;
+
+        uint32_t stack[64];
+        int top = 0;
+        uint32_t current = 0;
+        for (;;)
+        {
+            const BVHNode &node = m_nodes[current];
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    float t, u, v;
+                    if (intersect_triangle(m_triangles[i], origin, dir, t, u, v) && t < best)
+                    {
+                        best = t;
+                        hit = RayHit{t, m_triangle_ids[i], u, v};
+                    }
+                }
+            }
+            else
+            {
+                // Visit the nearer child first, the farther one is often culled by then
+                float t_left, t_right;
+                bool left = intersect_box(m_nodes[node.first].bounds, origin, inv_dir, best, t_left);
+                bool right = intersect_box(m_nodes[node.first + 1].bounds, origin, inv_dir, best, t_right);
+                if (left && right)
+                {
+                    uint32_t near_child = t_left <= t_right ? node.first : node.first + 1;
+                    stack[top++] = near_child == node.first ? node.first + 1 : node.first;
+                    current = near_child;
+                    continue;
+                }
+                if (left || right)
+                {
+                    current = left ? node.first : node.first + 1;
+                    continue;
+                }
+            }
+
+            // Pop, skipping nodes the current best hit already rules out
+            bool found = false;
+            while (top > 0)
+            {
+                uint32_t candidate = stack[--top];
+                if (intersect_box(m_nodes[candidate].bounds, origin, inv_dir, best, t_enter))
+                {
+                    current = candidate;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                break;
+        }
+        return hit;
+    }
+
+    /**
+     * @brief Finds the point on the mesh closest to p, ignoring anything farther than max_distance
+     *
+     */
+    std::optional<ClosestHit> closest_point(const math::Vec3 &p, float max_distance = INFINITY) const
+    {
+        std::optional<ClosestHit> result;
+        if (m_triangles.empty())
+            return result;
+
+        float best = max_distance * max_distance;
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BVHNode &node = m_nodes[stack[--top]];
+            if (box_distance_sq(node.bounds, p) >= best)
+                continue;
+
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    math::Vec3 q = closest_on_triangle(m_triangles[i], p);
+                    math::Vec3 d = q - p;
+                    float dist = math::dot(d, d);
+                    if (dist < best)
+                    {
+                        best = dist;
+                        result = ClosestHit{q, dist, m_triangle_ids[i]};
+                    }
+                }
+            }
+            else
+            {
+                // Push the farther child first so the nearer one is searched first
+                float d_left = box_distance_sq(m_nodes[node.first].bounds, p);
+                float d_right = box_distance_sq(m_nodes[node.first + 1].bounds, p);
+                if (d_left <= d_right)
+                {
+                    stack[top++] = node.first + 1;
+                    stack[top++] = node.first;
+                }
+                else
+                {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                }
+            }
+        }
+        return result;
+    }
+
+    const math::AABB &bounds() const { return m_nodes[0].bounds; }
+    size_t node_count() const { return m_nodes.size(); }
+    size_t triangle_count() const { return m_triangles.size(); }
+    uint32_t depth() const { return m_depth; }
+    double build_ms() const { return m_build_ms; }
+
+    size_t memory_bytes() const
+    {
+        return m_nodes.capacity() * sizeof(BVHNode) + m_triangles.capacity() * sizeof(Triangle) +
+               m_triangle_ids.capacity() * sizeof(uint32_t);
+    }
+};
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "Math.hpp"
+
+/**
+ * @brief Finds which of many moving boxes overlap, using a hashed uniform grid.
+ *
+ * Every box is listed in the grid cells it touches. Moving a box only touches the grid when it
+ * crosses into other cells, which for small steps is rare, so keeping the grid current costs
+ * about one comparison per object. Pairs are then only tested within a cell, and a pair sharing
+ * several cells is reported by the one holding the low corner of their overlap, so no pair set
+ * is needed. Cells are scanned in parallel, each slice writing its own list.
+ *
+ * Boxes spanning more than max_cells_per_object cells would flood the grid; they are kept aside
+ * and tested against everything instead.
+ *
+ */
+class Broadphase
+{
+public:
+    using Proxy = uint32_t;
+    static constexpr Proxy invalid_proxy = UINT32_MAX;
+    static constexpr size_t max_cells_per_object = 64;
+    static constexpr size_t parallel_threshold = 1024; // cells below which pairs are found inline
+
+    struct Pair
+    {
+        uint32_t a; // user values of the two objects, a < b
+        uint32_t b;
+    };
+
+    struct Stats
+    {
+        size_t objects = 0;
+        size_t pairs = 0;
+        size_t cells = 0;     // cells holding at least one object
+        size_t oversized = 0; // objects kept out of the grid
+        size_t regridded = 0; // moves since the last update that changed cells, low when motion is coherent
+        float update_ms = 0.0f;
+    };
+
+private:
+    struct CellRange
+    {
+        int32_t min[3];
+        int32_t max[3];
+
+        bool operator==(const CellRange &o) const
+        {
+            return min[0] == o.min[0] && min[1] == o.min[1] && min[2] == o.min[2] && max[0] == o.max[0] &&
+                   max[1] == o.max[1] && max[2] == o.max[2];
+        }
+
+        size_t cell_count() const
+        {
+            return size_t(max[0] - min[0] + 1) * size_t(max[1] - min[1] + 1) * size_t(max[2] - min[2] + 1);
+        }
+    };
+
+    struct Cell
+    {
+        int32_t coords[3];
+        std::vector<Proxy> proxies;
+    };
+
+    float m_cell_size;
+    float m_inv_cell_size;
+
+    // Per proxy
+    std::vector<math::AABB> m_boxes;
+    std::vector<uint32_t> m_user;
+    std::vector<CellRange> m_ranges;
+    std::vector<uint8_t> m_alive;
+    std::vector<uint8_t> m_oversized;
+    std::vector<Proxy> m_free;
+    size_t m_live = 0;
+
+    // Occupied cells, empty ones are recycled
+    std::vector<Cell> m_cells;
+    std::vector<uint32_t> m_free_cells;
+    std::unordered_map<uint64_t, uint32_t> m_cell_of_key;
+    std::vector<Proxy> m_oversized_list;
+
+    std::vector<std::vector<Pair>> m_slice_pairs;
+    std::vector<Pair> m_pairs;
+    size_t m_regridded = 0;
+    Stats m_stats;
+
+    static bool overlap(const math::AABB &a, const math::AABB &b)
+    {
+        // Non-short-circuit ands, the outcome is too unpredictable for six branches to pay off
+        return (a.min.x <= b.max.x) & (b.min.x <= a.max.x) & (a.min.y <= b.max.y) & (b.min.y <= a.max.y) &
+               (a.min.z <= b.max.z) & (b.min.z <= a.max.z);
+    }
+
+    static uint64_t key(int32_t x, int32_t y, int32_t z)
+    {
+        // 21 bits per axis, cells further than a million cell sizes from the origin wrap around
+        auto bits = [](int32_t v) { return uint64_t(uint32_t(v) & 0x1fffff); };
+        return bits(x) | bits(y) << 21 | bits(z) << 42;
+    }
+
+    int32_t cell_coord(float v) const { return static_cast<int32_t>(std::floor(v * m_inv_cell_size)); }
+
+    CellRange range_of(const math::AABB &box) const
+    {
+        return {{cell_coord(box.min.x), cell_coord(box.min.y), cell_coord(box.min.z)},
+                {cell_coord(box.max.x), cell_coord(box.max.y), cell_coord(box.max.z)}};
+    }
+
+    /**
+     * @brief Whether a cell is the one reporting an overlap, the one holding the overlap's low corner
+     *
+     */
+    static bool owns(const Cell &cell, const CellRange &a, const CellRange &b)
+    {
+        // Cell coordinates are monotonic in position, so the overlap's low corner is in the cell of the larger minimums
+        return std::max(a.min[0], b.min[0]) == cell.coords[0] && std::max(a.min[1], b.min[1]) == cell.coords[1] &&
+               std::max(a.min[2], b.min[2]) == cell.coords[2];
+    }
+
+    template <typename Fn>
+    static void for_each_cell(const CellRange &range, Fn &&fn)
+    {
+        for (int32_t z = range.min[2]; z <= range.max[2]; z++)
+            for (int32_t y = range.min[1]; y <= range.max[1]; y++)
+                for (int32_t x = range.min[0]; x <= range.max[0]; x++)
+                    fn(x, y, z);
+    }
+
+    void insert(Proxy proxy)
+    {
+        const CellRange &range = m_ranges[proxy];
+        if (range.cell_count() > max_cells_per_object)
+        {
+            m_oversized[proxy] = 1;
+            m_oversized_list.push_back(proxy);
+            return;
+        }
+        m_oversized[proxy] = 0;
+        for_each_cell(range, [&](int32_t x, int32_t y, int32_t z) {
+            auto [found, inserted] = m_cell_of_key.try_emplace(key(x, y, z), 0);
+            if (inserted)
+            {
+                if (!m_free_cells.empty())
+                {
+                    found->second = m_free_cells.back();
+                    m_free_cells.pop_back();
+                }
+                else
+                {
+                    found->second = static_cast<uint32_t>(m_cells.size());
+                    m_cells.emplace_back();
+                }
+                Cell &cell = m_cells[found->second];
+                cell.coords[0] = x;
+                cell.coords[1] = y;
+                cell.coords[2] = z;
+            }
+            m_cells[found->second].proxies.push_back(proxy);
+        });
+    }
+
+    void erase(Proxy proxy)
+    {
+        if (m_oversized[proxy])
+        {
+            m_oversized_list.erase(std::find(m_oversized_list.begin(), m_oversized_list.end(), proxy));
+            return;
+        }
+        for_each_cell(m_ranges[proxy], [&](int32_t x, int32_t y, int32_t z) {
+            auto found = m_cell_of_key.find(key(x, y, z));
+            std::vector<Proxy> &proxies = m_cells[found->second].proxies;
+            *std::find(proxies.begin(), proxies.end(), proxy) = proxies.back();
+            proxies.pop_back();
+            if (proxies.empty())
+            {
+                m_free_cells.push_back(found->second);
+                m_cell_of_key.erase(found);
+            }
+        });
+    }
+
+    void add_pair(uint32_t a, uint32_t b, std::vector<Pair> &out) const
+    {
+        out.push_back(a < b ? Pair{a, b} : Pair{b, a});
+    }
+
+    void find_pairs(size_t begin, size_t end, std::vector<Pair> &out) const
+    {
+        // The cell's boxes and ranges side by side, the pair loop reads each many times
+        std::vector<math::AABB> boxes;
+        std::vector<CellRange> ranges;
+        for (size_t c = begin; c < end; c++)
+        {
+            const Cell &cell = m_cells[c];
+            const std::vector<Proxy> &proxies = cell.proxies;
+            if (proxies.size() < 2)
+                continue;
+            boxes.clear();
+            ranges.clear();
+            for (Proxy proxy : proxies)
+            {
+                boxes.push_back(m_boxes[proxy]);
+                ranges.push_back(m_ranges[proxy]);
+            }
+
+            for (size_t i = 0; i + 1 < boxes.size(); i++)
+            {
+                for (size_t j = i + 1; j < boxes.size(); j++)
+                {
+                    if (overlap(boxes[i], boxes[j]) && owns(cell, ranges[i], ranges[j]))
+                        add_pair(m_user[proxies[i]], m_user[proxies[j]], out);
+                }
+            }
+        }
+    }
+
+public:
+    /**
+     * @param cell_size Edge of a grid cell in world units, around twice the typical object size works well
+     */
+    Broadphase(float cell_size = 4.0f) : m_cell_size(cell_size), m_inv_cell_size(1.0f / cell_size) {}
+
+    Proxy add(const math::AABB &box, uint32_t user)
+    {
+        Proxy proxy;
+        if (!m_free.empty())
+        {
+            proxy = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            proxy = static_cast<Proxy>(m_boxes.size());
+            m_boxes.emplace_back();
+            m_user.emplace_back();
+            m_ranges.emplace_back();
+            m_alive.emplace_back();
+            m_oversized.emplace_back();
+        }
+        m_boxes[proxy] = box;
+        m_user[proxy] = user;
+        m_ranges[proxy] = range_of(box);
+        m_alive[proxy] = 1;
+        m_live++;
+        insert(proxy);
+        return proxy;
+    }
+
+    void remove(Proxy proxy)
+    {
+        erase(proxy);
+        m_alive[proxy] = 0;
+        m_free.push_back(proxy);
+        m_live--;
+    }
+
+    /**
+     * @brief Moves an object, only touching the grid if it now covers other cells
+     *
+     */
+    void move(Proxy proxy, const math::AABB &box)
+    {
+        m_boxes[proxy] = box;
+        CellRange range = range_of(box);
+        if (range == m_ranges[proxy])
+            return;
+        erase(proxy);
+        m_ranges[proxy] = range;
+        insert(proxy);
+        m_regridded++;
+    }
+
+    /**
+     * @brief Finds every overlapping pair of objects
+     *
+     * @return The pairs, valid until the next update
+     */
+    const std::vector<Pair> &update(JobSystem &jobs = JobSystem::shared())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // Recycled cells are empty and cost nothing to scan
+        m_pairs.clear();
+        size_t cells = m_cells.size();
+        if (cells < parallel_threshold || jobs.concurrency() == 1)
+            find_pairs(0, cells, m_pairs);
+        else
+        {
+            size_t slices = jobs.concurrency() * 8;
+            size_t slice_size = (cells + slices - 1) / slices;
+            m_slice_pairs.resize(slices);
+            jobs.parallel_for(0, slices, 1, [&](size_t b, size_t e) {
+                for (size_t s = b; s < e; s++)
+                {
+                    m_slice_pairs[s].clear();
+                    find_pairs(std::min(cells, s * slice_size), std::min(cells, (s + 1) * slice_size), m_slice_pairs[s]);
+                }
+            });
+            for (const auto &slice : m_slice_pairs)
+                m_pairs.insert(m_pairs.end(), slice.begin(), slice.end());
+        }
+
+        // Oversized objects against everything, each pair once
+        for (Proxy big : m_oversized_list)
+        {
+            for (Proxy other = 0; other < m_boxes.size(); other++)
+            {
+                if (!m_alive[other] || other == big || (m_oversized[other] && other < big))
+                    continue;
+                if (overlap(m_boxes[big], m_boxes[other]))
+                    add_pair(m_user[big], m_user[other], m_pairs);
+            }
+        }
+
+        m_stats.objects = m_live;
+        m_stats.pairs = m_pairs.size();
+        m_stats.cells = m_cell_of_key.size();
+        m_stats.oversized = m_oversized_list.size();
+        m_stats.regridded = m_regridded;
+        m_regridded = 0;
+        m_stats.update_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return m_pairs;
+    }
+
+    /**
+     * @brief User values of the objects overlapping a box, reusing the storage of result
+     *
+     */
+    template <typename Allocator>
+    void query(const math::AABB &box, std::vector<uint32_t, Allocator> &result) const
+    {
+        result.clear();
+        CellRange range = range_of(box);
+        if (range.cell_count() > max_cells_per_object)
+        {
+            for (Proxy proxy = 0; proxy < m_boxes.size(); proxy++)
+            {
+                if (m_alive[proxy] && overlap(box, m_boxes[proxy]))
+                    result.push_back(m_user[proxy]);
+            }
+            return;
+        }
+
+        for_each_cell(range, [&](int32_t x, int32_t y, int32_t z) {
+            auto found = m_cell_of_key.find(key(x, y, z));
+            if (found == m_cell_of_key.end())
+                return;
+            const Cell &cell = m_cells[found->second];
+            for (Proxy proxy : cell.proxies)
+            {
+                if (overlap(box, m_boxes[proxy]) && owns(cell, range, m_ranges[proxy]))
+                    result.push_back(m_user[proxy]);
+            }
+        });
+        for (Proxy proxy : m_oversized_list)
+        {
+            if (overlap(box, m_boxes[proxy]))
+                result.push_back(m_user[proxy]);
+        }
+    }
+
+    float cell_size() const { return m_cell_size; }
+    const std::vector<Pair> &pairs() const { return m_pairs; }
+    const Stats &stats() const { return m_stats; }
+};
+
+/**
+ * @brief Moves a sphere the shortest way out of a box it overlaps
+ *
+ * @return true if the sphere was pushed
+ */
+inline bool push_sphere_out(math::Vec3 &center, float radius, const math::AABB &box)
+{
+    math::Vec3 closest = math::min(math::max(center, box.min), box.max);
+    math::Vec3 offset = center - closest;
+    float distance_sq = math::dot(offset, offset);
+    if (distance_sq >= radius * radius)
+        return false;
+
+    if (distance_sq > 0.0f)
+    {
+        // Center outside the box: push along the direction to the nearest point
+        float distance = std::sqrt(distance_sq);
+        center = closest + offset * (radius / distance);
+        return true;
+    }
+
+    // Center inside the box: leave through the nearest face
+    float best = INFINITY;
+    int axis = 0;
+    float target = 0.0f;
+    for (int a = 0; a < 3; a++)
+    {
+        float to_min = center[a] - box.min[a], to_max = box.max[a] - center[a];
+        if (to_min < best)
+        {
+            best = to_min;
+            axis = a;
+            target = box.min[a] - radius;
+        }
+        if (to_max < best)
+        {
+            best = to_max;
+            axis = a;
+            target = box.max[a] + radius;
+        }
+    }
+    center[axis] = target;
+    return true;
+}
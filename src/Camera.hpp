@@ -2,60 +2,51 @@
 #define CAMERA_HPP
 
 #include <GLFW/glfw3.h>
-#include <cglm/cglm.h>
 #include <cmath>
-#include <cstring>  // For memcpy
+
+#include "Math.hpp"
 
 class Camera {
 public:
-    vec3 position;
+    math::Vec3 position;
     float yaw;
     float pitch;
     float speed;
     float sensitivity;
-    mat4 view_matrix;
+    math::Mat4 view_matrix;
+
+    // Derived from yaw and pitch, only recomputed when they change
+    math::Vec3 front;
+    math::Vec3 right;
 
-    Camera(const vec3& start_position) {
-        std::memcpy(position, start_position, sizeof(vec3));
+    Camera(const math::Vec3& start_position) {
+        position = start_position;
         yaw = -90.0f;
         pitch = 0.0f;
         speed = 2.5f;
         sensitivity = 0.1f;
-        glm_mat4_identity(view_matrix);
+        view_matrix = math::Mat4::identity();
+        updateVectors();
     }
 
     void processKeyboard(GLFWwindow* window, float delta_time) {
         float velocity = speed * delta_time;
-        vec3 front = {cos(glm_rad(yaw)) * cos(glm_rad(pitch)), sin(glm_rad(pitch)),
-                      sin(glm_rad(yaw)) * cos(glm_rad(pitch))};
-        glm_vec3_normalize(front);
-
-        vec3 right;
-        glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
-        glm_vec3_normalize(right);
 
-        vec3 temp;
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-            glm_vec3_scale(front, velocity, temp);
-            glm_vec3_add(position, temp, position);
+            position += front * velocity;
         }
         if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-            glm_vec3_scale(front, velocity, temp);
-            glm_vec3_sub(position, temp, position);
+            position -= front * velocity;
         }
         if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-            glm_vec3_scale(right, velocity, temp);
-            glm_vec3_sub(position, temp, position);
+            position -= right * velocity;
         }
         if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-            glm_vec3_scale(right, velocity, temp);
-            glm_vec3_add(position, temp, position);
+            position += right * velocity;
         }
         // Move up when SPACE is pressed
         if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-            vec3 up = {0.0f, 1.0f, 0.0f};
-            glm_vec3_scale(up, velocity, temp);
-            glm_vec3_add(position, temp, position);
+            position += math::Vec3{0.0f, 1.0f, 0.0f} * velocity;
         }
         // Quit when Q is pressed
         if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
@@ -63,6 +54,13 @@ public:
         }
     }
 
+    // Whether a movement key is held, which moves the camera every frame without new input events
+    bool isMoving(GLFWwindow* window) const {
+        return glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ||
+               glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS ||
+               glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+    }
+
     void processMouseOffset(float xoffset, float yoffset) {
         xoffset *= sensitivity;
         yoffset *= sensitivity;
@@ -74,19 +72,23 @@ public:
             pitch = 89.0f;
         if (pitch < -89.0f)
             pitch = -89.0f;
+
+        updateVectors();
     }
 
-    void updateViewMatrix() {
-        vec3 front = {cos(glm_rad(yaw)) * cos(glm_rad(pitch)), sin(glm_rad(pitch)),
-                      sin(glm_rad(yaw)) * cos(glm_rad(pitch))};
-        glm_vec3_normalize(front);
+    // Recomputes front and right from yaw and pitch
+    void updateVectors() {
+        float yaw_rad = math::radians(yaw);
+        float pitch_rad = math::radians(pitch);
+        float cos_pitch = std::cos(pitch_rad);
 
-        vec3 target;
-        glm_vec3_add(position, front, target);
+        front = math::normalize({std::cos(yaw_rad) * cos_pitch, std::sin(pitch_rad), std::sin(yaw_rad) * cos_pitch});
+        right = math::normalize(math::cross(front, {0.0f, 1.0f, 0.0f}));
+    }
 
-        glm_lookat(position, target, (vec3){0.0f, 1.0f, 0.0f}, view_matrix);
+    void updateViewMatrix() {
+        view_matrix = math::look_at(position, position + front, {0.0f, 1.0f, 0.0f});
     }
 };
 
 #endif // CAMERA_HPP
-
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Camera.hpp"
+#include "Math.hpp"
+
+/**
+ * @brief Input held down during a recorded frame, as bits of CameraFrame::input
+ *
+ */
+enum CameraInput : uint16_t
+{
+    InputForward = 1 << 0,
+    InputBack = 1 << 1,
+    InputLeft = 1 << 2,
+    InputRight = 1 << 3,
+    InputUp = 1 << 4,
+    InputMouseLeft = 1 << 5,
+    InputCameraMode = 1 << 6, // mouse look was active
+};
+
+/**
+ * @brief One frame of a camera path: the camera after the frame's input, and the input itself
+ *
+ */
+struct CameraFrame
+{
+    math::Vec3 position;
+    float yaw;
+    float pitch;
+    float mouse_dx; // mouse movement applied this frame, in pixels
+    float mouse_dy;
+    uint16_t input;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(CameraFrame) == 32, "CameraFrame is written to disk as is");
+
+/**
+ * @brief A recorded camera path, stored as a small header followed by the raw frames
+ *
+ * Replays don't re-simulate the input, they restore the recorded camera state each frame and
+ * advance time by the fixed timestep, so two builds replaying the same file render the same
+ * frames regardless of how fast they run.
+ *
+ */
+class CameraPath
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t frame_count;
+        float timestep; // seconds per frame on replay
+    };
+
+    static constexpr char magic[8] = {'C', 'A', 'M', 'P', 'A', 'T', 'H', '\0'};
+    static constexpr uint32_t version = 1;
+
+public:
+    std::vector<CameraFrame> frames;
+    float timestep = 1.0f / 60.0f;
+
+    void record(const Camera &camera, float mouse_dx, float mouse_dy, uint16_t input)
+    {
+        frames.push_back({camera.position, camera.yaw, camera.pitch, mouse_dx, mouse_dy, input, 0});
+    }
+
+    /**
+     * @brief Puts the camera where it was on a recorded frame
+     *
+     */
+    void apply(size_t frame, Camera &camera) const
+    {
+        const CameraFrame &f = frames[frame];
+        camera.position = f.position;
+        camera.yaw = f.yaw;
+        camera.pitch = f.pitch;
+        camera.updateVectors();
+    }
+
+    bool save(const std::string &path) const
+    {
+        Header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.frame_count = static_cast<uint32_t>(frames.size());
+        header.timestep = timestep;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(frames.data()), frames.size() * sizeof(CameraFrame));
+        return static_cast<bool>(file);
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        Header header;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.timestep <= 0.0f)
+            return false;
+
+        // The header alone mustn't decide the allocation, a corrupt count could ask for gigabytes
+        std::streamoff start = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - start;
+        file.seekg(start);
+        if (uint64_t(header.frame_count) * sizeof(CameraFrame) > uint64_t(remaining))
+            return false;
+
+        frames.resize(header.frame_count);
+        timestep = header.timestep;
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(frames.data()), frames.size() * sizeof(CameraFrame)));
+    }
+};
+
+/**
+ * @brief Frame times measured during a replay, for comparing two builds on the same path
+ *
+ */
+class ReplayReport
+{
+    std::vector<float> m_frame_ms;
+
+public:
+    void reserve(size_t frames) { m_frame_ms.reserve(frames); }
+    void add_frame(float ms) { m_frame_ms.push_back(ms); }
+    size_t size() const { return m_frame_ms.size(); }
+
+    /**
+     * @brief Exact percentile over every replayed frame
+     *
+     */
+    float percentile(float p) const
+    {
+        if (m_frame_ms.empty())
+            return 0.0f;
+        std::vector<float> sorted = m_frame_ms;
+        size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5f));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    /**
+     * @brief One line summary: frames, average, percentiles and worst frame
+     *
+     */
+    std::string summary() const
+    {
+        double total = 0.0;
+        float worst = 0.0f;
+        for (float ms : m_frame_ms)
+        {
+            total += ms;
+            worst = std::max(worst, ms);
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "replay: %zu frames, avg %.3f ms, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f ms",
+                      m_frame_ms.size(), m_frame_ms.empty() ? 0.0 : total / m_frame_ms.size(), percentile(0.50f),
+                      percentile(0.95f), percentile(0.99f), worst);
+        return line;
+    }
+
+    /**
+     * @brief Writes "frame,ms" per line so runs can be diffed or plotted
+     *
+     */
+    bool write_csv(const std::string &path) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << "frame,ms\n";
+        for (size_t i = 0; i < m_frame_ms.size(); i++)
+            file << i << ',' << m_frame_ms[i] << '\n';
+        return static_cast<bool>(file);
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "Renderer.hpp"
+
+namespace GUI {
+
+    class CollisionWidget : public Widget {
+    public:
+        CollisionWidget(Renderer& renderer) : m_Renderer(renderer) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Collision"))
+                return;
+
+            if (!m_Renderer.camera_collision) {
+                ImGui::TextUnformatted("Camera collision is off (Settings menu)");
+                return;
+            }
+
+            // The pairs are only searched for while they're shown here
+            m_Renderer.pair_search_requested = true;
+
+            const Broadphase::Stats& stats = m_Renderer.broadphase.stats();
+            ImGui::Text("%zu objects, %zu overlapping pairs", stats.objects, stats.pairs);
+            ImGui::Text("Update %.3f ms, %zu grid cells, %zu oversized", stats.update_ms, stats.cells, stats.oversized);
+            ImGui::Text("Moves that changed cells: %zu", stats.regridded);
+            ImGui::Text("Camera touching %zu models", m_Renderer.camera_contacts);
+            ImGui::SliderFloat("Camera radius", &m_Renderer.camera_radius, 0.05f, 2.0f);
+        }
+
+    private:
+        Renderer& m_Renderer;
+    };
+
+}
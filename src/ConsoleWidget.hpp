@@ -1,19 +1,30 @@
 // ConsoleWidget.hpp
 #pragma once
+#include "LogRingBuffer.hpp"
 #include "Menu.hpp"
-#include <string>
-#include <vector>
+#include "MessageQueue.hpp"
+#include <string_view>
 
 namespace GUI {
 
 class ConsoleWidget : public Widget {
 public:
-    void AddLog(const std::string& log) {
-        logs.push_back(log);
-        scroll_to_bottom = true;
+    ConsoleWidget(size_t max_lines = 2048, size_t arena_bytes = 256 * 1024, size_t queue_capacity = 1024)
+        : logs(max_lines, arena_bytes), pending(queue_capacity) {}
+
+    // Safe to call from any thread, the message shows up on the next Render
+    void AddLog(std::string_view log) {
+        pending.try_push(log);
+    }
+
+    // True when messages are waiting for the next Render
+    bool HasPending() const {
+        return !pending.empty();
     }
 
     void Render() override {
+        pending.drain([this](std::string_view log) { logs.push(log); });
+
         ImGui::SetNextWindowPos(ImVec2(0, ImGui::GetIO().DisplaySize.y - 150), ImGuiCond_Always);
         ImGui::SetNextWindowSize(ImVec2(ImGui::GetIO().DisplaySize.x, 150), ImGuiCond_Always);
 
@@ -22,27 +33,39 @@ public:
                      ImGuiWindowFlags_NoMove);
 
         if (ImGui::Button("Clear")) logs.clear();
+        if (pending.dropped() > 0) {
+            ImGui::SameLine();
+            ImGui::Text("%zu messages dropped", pending.dropped());
+        }
 
         ImGui::Separator();
 
         ImGui::BeginChild("ScrollingRegion", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
-        for (const auto& log : logs) {
-            ImGui::TextUnformatted(log.c_str());
+        // Follow new output only while the view is already at the bottom
+        bool at_bottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+
+        // Only the visible rows are submitted
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(logs.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                std::string_view line = logs.line(i);
+                ImGui::TextUnformatted(line.data(), line.data() + line.size());
+            }
         }
+        clipper.End();
 
-        if (scroll_to_bottom) {
+        if (at_bottom)
             ImGui::SetScrollHereY(1.0f);
-            scroll_to_bottom = false;
-        }
 
         ImGui::EndChild();
         ImGui::End();
     }
 
 private:
-    std::vector<std::string> logs;
-    bool scroll_to_bottom = false;
+    LogRingBuffer logs;
+    MessageQueue pending;
 };
 
 } // namespace GUI
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "Renderer.hpp"
+
+namespace GUI {
+
+    class CullingWidget : public Widget {
+    public:
+        CullingWidget(const Renderer& renderer) : m_Renderer(renderer) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Culling"))
+                return;
+
+            if (!m_Renderer.occlusion_culling) {
+                ImGui::TextUnformatted("Occlusion culling is off (Settings menu)");
+                return;
+            }
+
+            if (!m_Renderer.culler.has_occluders()) {
+                ImGui::TextUnformatted("No occluders, mark models with --occluder or in a scene file");
+                return;
+            }
+
+            const OcclusionCuller::Stats& stats = m_Renderer.culler.stats();
+            ImGui::Text("Drawn: %zu of %zu models", m_Renderer.drawn_models, m_Renderer.models.size());
+            ImGui::Text("Tested: %zu, outside view: %zu, occluded: %zu", stats.tested, stats.frustum_culled, stats.occluded);
+            ImGui::Text("Occluders: %zu triangles", stats.occluder_triangles);
+            ImGui::Text("Rasterized %dx%d in %.3f ms", m_Renderer.culler.width(), m_Renderer.culler.height(), stats.raster_ms);
+        }
+
+    private:
+        const Renderer& m_Renderer;
+    };
+
+}
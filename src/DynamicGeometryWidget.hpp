@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "Renderer.hpp"
+
+namespace GUI {
+
+    class DynamicGeometryWidget : public Widget {
+    public:
+        DynamicGeometryWidget(const Renderer& renderer) : m_Renderer(renderer) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Dynamic geometry"))
+                return;
+
+            if (m_Renderer.dynamic_meshes.empty()) {
+                ImGui::TextUnformatted("No dynamic meshes (Settings menu for the demo)");
+                return;
+            }
+
+            for (const DynamicMesh* mesh : m_Renderer.dynamic_meshes) {
+                const StreamBuffer& buffer = mesh->buffer();
+                const StreamBuffer::Stats& stats = buffer.stats();
+                ImGui::Text("%zu vertices, %zu regions, %s", mesh->vertex_count(), buffer.regions(),
+                            buffer.persistent() ? "persistently mapped" : "mapped unsynchronized");
+                ImGui::Text("  Update %.3f ms, %zu writes", mesh->update_ms(), stats.writes);
+                ImGui::Text("  Waited for the GPU %zu times, last %.1f us, total %.1f ms", stats.stalls, stats.last_wait_us,
+                            stats.total_wait_ms);
+                if (stats.lost_writes)
+                    ImGui::Text("  %zu writes lost by the driver", stats.lost_writes);
+            }
+        }
+
+    private:
+        const Renderer& m_Renderer;
+    };
+
+}
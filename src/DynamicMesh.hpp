@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "EdgeList.hpp"
+#include "Math.hpp"
+#include "StreamBuffer.hpp"
+#include "Vertex.hpp"
+
+/**
+ * @brief A mesh whose vertices are rewritten by the CPU every frame, with fixed indices.
+ *
+ * Unlike Model, which uploads once with GL_STATIC_DRAW, the vertices live in a StreamBuffer
+ * holding one copy per region. All copies share one vertex array object and element buffer;
+ * the draw picks the current copy with a base vertex, so switching regions binds nothing new.
+ * The indices are fixed, so their deduplicated edge list for GL_LINES is built once up front.
+ *
+ */
+class DynamicMesh
+{
+    StreamBuffer m_vertices;
+    GLuint m_vao = 0;
+    GLuint m_ebo = 0;
+    GLuint m_edge_vao = 0; // same vertices, edge list element buffer
+    GLuint m_edge_ebo = 0;
+    size_t m_vertex_count;
+    GLsizei m_index_count;
+    GLsizei m_edge_index_count;
+    Vertex *m_writing = nullptr;
+    size_t m_drawn_region = SIZE_MAX; // last region written completely, SIZE_MAX before the first update
+    std::chrono::steady_clock::time_point m_write_start;
+    float m_update_ms = 0.0f;
+
+    void create_vertex_array(GLuint &vao, GLuint &ebo, const std::vector<GLushort> &indices)
+    {
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+
+        // Region offsets are applied as a base vertex when drawing, so the pointers start at 0
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertices.id());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+public:
+    math::Mat4 transform = math::Mat4::identity(); // model to world
+
+    DynamicMesh(size_t vertex_count, const std::vector<GLushort> &indices, size_t regions = 3)
+        : m_vertices(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), regions), m_vertex_count(vertex_count),
+          m_index_count(static_cast<GLsizei>(indices.size()))
+    {
+        std::vector<GLushort> edges = build_edge_list(indices);
+        m_edge_index_count = static_cast<GLsizei>(edges.size());
+        create_vertex_array(m_vao, m_ebo, indices);
+        create_vertex_array(m_edge_vao, m_edge_ebo, edges);
+    }
+
+    DynamicMesh(const DynamicMesh &) = delete;
+    DynamicMesh &operator=(const DynamicMesh &) = delete;
+
+    ~DynamicMesh()
+    {
+        glDeleteVertexArrays(1, &m_vao);
+        glDeleteBuffers(1, &m_ebo);
+        glDeleteVertexArrays(1, &m_edge_vao);
+        glDeleteBuffers(1, &m_edge_ebo);
+    }
+
+    /**
+     * @brief The next copy of the vertices to fill, all vertex_count() of them, null if it couldn't be mapped
+     *
+     * The memory may be write combined: write it sequentially and don't read it back.
+     */
+    Vertex *begin_update()
+    {
+        m_write_start = std::chrono::steady_clock::now();
+        m_writing = static_cast<Vertex *>(m_vertices.begin_write());
+        return m_writing;
+    }
+
+    void end_update()
+    {
+        m_vertices.end_write();
+        if (m_writing)
+            m_drawn_region = m_vertices.region();
+        m_writing = nullptr;
+        m_update_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_write_start).count();
+    }
+
+    /**
+     * @brief Draws the last written vertices and fences them, the shader's model matrix has to be set already
+     *
+     */
+    void draw(GLenum mode)
+    {
+        if (m_drawn_region == SIZE_MAX)
+            return;
+        bool lines = mode == GL_LINES;
+        glBindVertexArray(lines ? m_edge_vao : m_vao);
+        glDrawElementsBaseVertex(mode, lines ? m_edge_index_count : m_index_count, GL_UNSIGNED_SHORT, 0,
+                                 static_cast<GLint>(m_drawn_region * m_vertex_count));
+        glBindVertexArray(0);
+        m_vertices.fence(m_drawn_region);
+    }
+
+    size_t vertex_count() const { return m_vertex_count; }
+    GLsizei index_count() const { return m_index_count; }
+    GLsizei edge_index_count() const { return m_edge_index_count; }
+    float update_ms() const { return m_update_ms; }
+    const StreamBuffer &buffer() const { return m_vertices; }
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "JobSystem.hpp"
+
+/**
+ * @brief Unique edges of a triangle list, as pairs of indices for drawing with GL_LINES.
+ *
+ * Every triangle contributes its three edges keyed by (smaller, larger) index, and edges shared
+ * between triangles are kept once, so a closed mesh draws about half the lines of a per-triangle
+ * conversion. Large meshes are split across the job system: each chunk of triangles scatters its
+ * keys into hash-selected buckets, then each bucket is deduplicated on its own. Output order is
+ * deterministic.
+ *
+ */
+namespace edge_list
+{
+
+constexpr size_t parallel_threshold = 16384; // triangles below which everything runs inline
+constexpr uint32_t empty_key = UINT32_MAX;   // never a valid edge, that would need a == b == 65535
+
+inline uint32_t edge_key(GLushort a, GLushort b)
+{
+    return a < b ? (uint32_t(a) << 16) | b : (uint32_t(b) << 16) | a;
+}
+
+inline uint32_t hash(uint32_t key)
+{
+    key ^= key >> 16;
+    key *= 0x7feb352du;
+    key ^= key >> 15;
+    key *= 0x846ca68bu;
+    key ^= key >> 16;
+    return key;
+}
+
+// From the high bits of the hash, the low bits pick slots in dedup()'s table
+inline size_t bucket_of(uint32_t key, size_t buckets)
+{
+    return static_cast<size_t>((uint64_t(hash(key)) * buckets) >> 32);
+}
+
+/**
+ * @brief Appends the keys not seen before to out, using an open addressing set sized for keys
+ *
+ */
+inline void dedup(const uint32_t *keys, size_t count, std::vector<uint32_t> &table, std::vector<uint32_t> &out)
+{
+    size_t capacity = 16;
+    while (capacity < count * 2)
+        capacity *= 2;
+    table.assign(capacity, empty_key);
+    size_t mask = capacity - 1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t key = keys[i];
+        for (size_t slot = hash(key) & mask;; slot = (slot + 1) & mask)
+        {
+            if (table[slot] == key)
+                break;
+            if (table[slot] == empty_key)
+            {
+                table[slot] = key;
+                out.push_back(key);
+                break;
+            }
+        }
+    }
+}
+
+inline void append_edges(const std::vector<uint32_t> &keys, std::vector<GLushort> &edges)
+{
+    for (uint32_t key : keys)
+    {
+        edges.push_back(static_cast<GLushort>(key >> 16));
+        edges.push_back(static_cast<GLushort>(key & 0xffff));
+    }
+}
+
+} // namespace edge_list
+
+/**
+ * @brief Builds a deduplicated GL_LINES index list from a GL_TRIANGLES index list
+ *
+ */
+inline std::vector<GLushort> build_edge_list(const std::vector<GLushort> &indices, JobSystem &jobs = JobSystem::shared())
+{
+    using namespace edge_list;
+
+    size_t triangle_count = indices.size() / 3;
+    auto triangle_keys = [&](size_t t, uint32_t out[3]) {
+        GLushort a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+        out[0] = a != b ? edge_key(a, b) : empty_key;
+        out[1] = b != c ? edge_key(b, c) : empty_key;
+        out[2] = c != a ? edge_key(c, a) : empty_key;
+    };
+
+    std::vector<GLushort> edges;
+    if (triangle_count < parallel_threshold || jobs.concurrency() == 1)
+    {
+        std::vector<uint32_t> keys, table, unique;
+        keys.reserve(triangle_count * 3);
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            uint32_t k[3];
+            triangle_keys(t, k);
+            for (uint32_t key : k)
+            {
+                if (key != empty_key) // degenerate edge
+                    keys.push_back(key);
+            }
+        }
+        dedup(keys.data(), keys.size(), table, unique);
+        edges.reserve(unique.size() * 2);
+        append_edges(unique, edges);
+        return edges;
+    }
+
+    // Scatter: chunk c writes the keys of its triangles into scattered[c][bucket]
+    size_t buckets = jobs.concurrency() * 4;
+    size_t chunk_size = (triangle_count + buckets - 1) / buckets;
+    size_t chunks = (triangle_count + chunk_size - 1) / chunk_size;
+    std::vector<std::vector<std::vector<uint32_t>>> scattered(chunks, std::vector<std::vector<uint32_t>>(buckets));
+
+    jobs.parallel_for(0, chunks, 1, [&](size_t b, size_t e) {
+        for (size_t c = b; c < e; c++)
+        {
+            size_t end = std::min(triangle_count, (c + 1) * chunk_size);
+            for (size_t t = c * chunk_size; t < end; t++)
+            {
+                uint32_t k[3];
+                triangle_keys(t, k);
+                for (uint32_t key : k)
+                {
+                    if (key != empty_key)
+                        scattered[c][bucket_of(key, buckets)].push_back(key);
+                }
+            }
+        }
+    });
+
+    // Dedup: a key always lands in the same bucket, so buckets are independent
+    std::vector<std::vector<uint32_t>> unique(buckets);
+    jobs.parallel_for(0, buckets, 1, [&](size_t b, size_t e) {
+        std::vector<uint32_t> keys, table;
+        for (size_t bucket = b; bucket < e; bucket++)
+        {
+            keys.clear();
+            for (size_t c = 0; c < chunks; c++)
+                keys.insert(keys.end(), scattered[c][bucket].begin(), scattered[c][bucket].end());
+            dedup(keys.data(), keys.size(), table, unique[bucket]);
+        }
+    });
+
+    size_t total = 0;
+    for (const auto &bucket : unique)
+        total += bucket.size();
+    edges.reserve(total * 2);
+    for (const auto &bucket : unique)
+        append_edges(bucket, edges);
+    return edges;
+}
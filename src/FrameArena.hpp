@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Bump allocator for data that only lives for one frame. Allocating is a pointer bump,
+ * freeing individual allocations is a no-op, and reset() releases everything at once.
+ * When a frame needs more than the current capacity another block is added and kept, so
+ * after a few warm-up frames the arena stops touching the heap entirely.
+ *
+ */
+class FrameArena
+{
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_block = 0;  // block currently being bumped
+    size_t m_offset = 0; // offset into that block
+    size_t m_used = 0;   // bytes handed out this frame
+    size_t m_high_water = 0;
+    size_t m_last_frame_used = 0;
+
+    void add_block(size_t min_size)
+    {
+        size_t size = std::max(min_size, m_blocks.empty() ? size_t(4096) : m_blocks.back().size * 2);
+        m_blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    }
+
+public:
+    FrameArena(size_t initial_capacity = 64 * 1024) { add_block(initial_capacity); }
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    /**
+     * @brief Returns uninitialised memory valid until the next reset()
+     *
+     */
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        for (;;)
+        {
+            Block &block = m_blocks[m_block];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            uintptr_t aligned = (base + m_offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            size_t end = aligned - base + bytes;
+            if (end <= block.size)
+            {
+                m_used += end - m_offset;
+                m_offset = end;
+                m_high_water = std::max(m_high_water, m_used);
+                return reinterpret_cast<void *>(aligned);
+            }
+
+            // Move on to the next block, growing the arena if this was the last one
+            m_used += block.size - m_offset;
+            if (m_block + 1 == m_blocks.size())
+                add_block(bytes + alignment);
+            m_block++;
+            m_offset = 0;
+        }
+    }
+
+    template <typename T>
+    T *allocate_array(size_t count)
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief Releases every allocation made since the last reset, call once per frame
+     *
+     */
+    void reset()
+    {
+        m_last_frame_used = m_used;
+        m_block = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+    size_t used() const { return m_used; }
+    size_t last_frame_used() const { return m_last_frame_used; }
+    size_t high_water() const { return m_high_water; }
+
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const auto &block : m_blocks)
+            total += block.size;
+        return total;
+    }
+};
+
+/**
+ * @brief Standard allocator adapter so containers can live in a FrameArena, e.g. FrameVector<int>
+ *
+ */
+template <typename T>
+class FrameAllocator
+{
+public:
+    using value_type = T;
+
+    FrameArena *arena;
+
+    FrameAllocator(FrameArena &arena) : arena(&arena) {}
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena)
+    {
+    }
+
+    T *allocate(size_t n) { return arena->allocate_array<T>(n); }
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const FrameAllocator<U> &other) const
+    {
+        return arena != other.arena;
+    }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
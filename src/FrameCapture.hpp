@@ -0,0 +1,302 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ImageFile.hpp"
+#include "MessageQueue.hpp"
+
+/**
+ * @brief Saves rendered frames to image files without stalling the frame that asked for them.
+ *
+ * capture() only queues a glReadPixels into a pixel buffer object and a fence behind it, so the
+ * copy runs on the GPU after that frame's draws. poll() maps the buffer once its fence has
+ * passed, normally a frame later, or blocks when a readback is max_latency_frames old so captures
+ * are never delayed further. The pixels are then flipped, converted and written by an encoder
+ * thread. Messages about finished files are queued for the console.
+ *
+ */
+class FrameCapture
+{
+public:
+    static constexpr size_t slot_count = 3;
+    static constexpr uint64_t max_latency_frames = 2;
+
+    struct Stats
+    {
+        size_t requested = 0;
+        size_t written = 0;
+        size_t failed = 0;
+        size_t waited = 0;        // readbacks that had to block at max_latency_frames
+        uint64_t last_latency = 0; // frames between the capture and mapping its pixels
+        float last_map_ms = 0.0f;  // time on the render thread to map and copy out the pixels
+        float last_encode_ms = 0.0f;
+    };
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr; // null when the slot is free
+        int width = 0;
+        int height = 0;
+        uint64_t frame = 0;
+        std::string path;
+    };
+
+    struct EncodeJob
+    {
+        std::string path;
+        int width;
+        int height;
+        std::vector<uint8_t> rgba; // bottom row first, as read
+    };
+
+    Slot m_slots[slot_count];
+    std::deque<std::string> m_requests;
+    uint64_t m_frame = 0;
+    Stats m_stats;
+    MessageQueue m_messages{64};
+
+    // Encoding and disk writes get their own thread, like the page loader's reads
+    std::thread m_encoder;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<EncodeJob> m_jobs;
+    bool m_encoding = false;
+    bool m_stop = false;
+
+    void encoder_loop()
+    {
+        std::vector<uint8_t> rgb;
+        for (;;)
+        {
+            EncodeJob job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    return; // stopping, and everything queued is written
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                m_encoding = true;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            // OpenGL rows start at the bottom, image files at the top
+            rgb.resize(size_t(job.width) * job.height * 3);
+            for (int y = 0; y < job.height; y++)
+            {
+                const uint8_t *src = job.rgba.data() + size_t(job.height - 1 - y) * job.width * 4;
+                uint8_t *dst = rgb.data() + size_t(y) * job.width * 3;
+                for (int x = 0; x < job.width; x++)
+                {
+                    dst[3 * x] = src[4 * x];
+                    dst[3 * x + 1] = src[4 * x + 1];
+                    dst[3 * x + 2] = src[4 * x + 2];
+                }
+            }
+            bool ok = write_image(job.path, job.width, job.height, rgb.data());
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            m_messages.try_push((ok ? "Saved " : "Couldn't write ") + job.path);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            (ok ? m_stats.written : m_stats.failed)++;
+            m_stats.last_encode_ms = ms;
+            m_encoding = false;
+            m_idle.notify_all();
+        }
+    }
+
+    /**
+     * @brief Copies a finished readback out of its buffer and hands it to the encoder, freeing the slot
+     *
+     */
+    void retire(Slot &slot)
+    {
+        auto start = std::chrono::steady_clock::now();
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        EncodeJob job{std::move(slot.path), slot.width, slot.height, {}};
+        size_t bytes = size_t(slot.width) * slot.height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT))
+        {
+            job.rgba.resize(bytes);
+            std::memcpy(job.rgba.data(), pixels, bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_stats.last_latency = m_frame - slot.frame;
+        m_stats.last_map_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (job.rgba.empty())
+        {
+            m_stats.failed++;
+            m_messages.try_push("Couldn't read back " + job.path);
+            return;
+        }
+        m_jobs.push_back(std::move(job));
+        m_wake.notify_one();
+    }
+
+public:
+    FrameCapture() { m_encoder = std::thread([this] { encoder_loop(); }); }
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    ~FrameCapture()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_encoder.join();
+    }
+
+    /**
+     * @brief Asks for the next captured frame to be saved to path, as PNG, or PPM for a .ppm path
+     *
+     */
+    void request(std::string path)
+    {
+        m_requests.push_back(std::move(path));
+        m_stats.requested++;
+    }
+
+    bool wants_capture() const { return !m_requests.empty(); }
+
+    /**
+     * @brief Starts reading back a framebuffer's color for the oldest request, once per frame at most
+     *
+     * If every slot is still in flight the request waits for a later frame.
+     */
+    void capture(GLuint framebuffer, int width, int height)
+    {
+        if (m_requests.empty())
+            return;
+        Slot *slot = nullptr;
+        for (Slot &s : m_slots)
+        {
+            if (!s.fence)
+            {
+                slot = &s;
+                break;
+            }
+        }
+        if (!slot)
+            return;
+
+        size_t bytes = size_t(width) * height * 4;
+        if (!slot->pbo)
+            glGenBuffers(1, &slot->pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        if (slot->capacity < bytes)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            slot->capacity = bytes;
+        }
+
+        // With a pack buffer bound glReadPixels writes at offset 0 of it and returns immediately
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot->width = width;
+        slot->height = height;
+        slot->frame = m_frame;
+        slot->path = std::move(m_requests.front());
+        m_requests.pop_front();
+    }
+
+    /**
+     * @brief Call once per frame: hands finished readbacks to the encoder
+     *
+     */
+    void poll()
+    {
+        m_frame++;
+        for (Slot &slot : m_slots)
+        {
+            if (!slot.fence)
+                continue;
+            GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED && m_frame - slot.frame >= max_latency_frames)
+            {
+                while ((status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000)) == GL_TIMEOUT_EXPIRED)
+                    ;
+                m_stats.waited++;
+            }
+            if (status != GL_TIMEOUT_EXPIRED)
+                retire(slot);
+        }
+    }
+
+    /**
+     * @brief Whether captures are still requested, in flight or being written
+     *
+     */
+    bool busy()
+    {
+        for (const Slot &slot : m_slots)
+        {
+            if (slot.fence)
+                return true;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_requests.empty() || !m_jobs.empty() || m_encoding;
+    }
+
+    /**
+     * @brief Finishes every readback in flight, waits for the files and deletes the buffers
+     *
+     * Needs the context, so call it before the window goes away. Requests not yet captured are dropped.
+     */
+    void close()
+    {
+        m_requests.clear();
+        for (Slot &slot : m_slots)
+        {
+            if (slot.fence)
+            {
+                glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                retire(slot);
+            }
+            glDeleteBuffers(1, &slot.pbo);
+            slot.pbo = 0;
+            slot.capacity = 0;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_jobs.empty() && !m_encoding; });
+    }
+
+    /**
+     * @brief "Saved <path>" or error messages from the encoder, drained by the render thread
+     *
+     */
+    MessageQueue &messages() { return m_messages; }
+
+    Stats stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#include <GLFW/glfw3.h>
+
+/**
+ * @brief Decides when the main loop should run a frame and how long it should wait between frames.
+ *
+ * In on-demand mode the loop blocks in glfwWaitEventsTimeout while nothing is dirty instead of
+ * spinning, and a few extra frames are run after every input event so ImGui can settle hover and
+ * animation state. With a target rate set, frames are spaced by sleeping most of the remaining time
+ * and spinning the last couple of milliseconds, since sleeps usually overshoot by about a scheduler tick.
+ *
+ */
+class FramePacer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    bool on_demand = false;
+    int target_fps = 0;         // 0 = unlimited
+    double idle_timeout = 0.5;  // seconds, the longest an idle wait blocks
+    double spin_margin = 0.002; // seconds spun instead of slept at the end of each frame
+    int ui_settle_frames = 3;
+
+private:
+    clock::time_point m_next_frame = clock::now();
+    int m_ui_frames_left = 1;
+
+public:
+    /**
+     * @brief Call for every input or window event, keeps the loop awake for a few frames
+     *
+     */
+    void notify_input() { m_ui_frames_left = ui_settle_frames; }
+
+    /**
+     * @brief Whether a frame has to be presented: the scene changed, or the UI still needs frames
+     *
+     */
+    bool needs_frame(bool scene_dirty) const { return !on_demand || scene_dirty || m_ui_frames_left > 0; }
+
+    /**
+     * @brief Pumps window events, blocking while idle in on-demand mode
+     *
+     * @param busy Whether there is outstanding work, e.g. a dirty scene or pending console output
+     * @return true if the call blocked waiting for events
+     */
+    bool poll_events(bool busy)
+    {
+        if (on_demand && !busy && m_ui_frames_left == 0)
+        {
+            glfwWaitEventsTimeout(idle_timeout);
+            // Don't let the idle time count against the limiter schedule
+            m_next_frame = clock::now();
+            return true;
+        }
+        glfwPollEvents();
+        return false;
+    }
+
+    /**
+     * @brief Call after presenting a frame
+     *
+     */
+    void frame_presented()
+    {
+        if (m_ui_frames_left > 0)
+            m_ui_frames_left--;
+    }
+
+    /**
+     * @brief Blocks until the next frame is due at target_fps, does nothing when unlimited
+     *
+     */
+    void limit()
+    {
+        if (target_fps <= 0)
+            return;
+
+        auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / target_fps));
+        auto margin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(spin_margin));
+
+        m_next_frame += period;
+        auto now = clock::now();
+        if (m_next_frame < now)
+        {
+            // Running behind: start a fresh schedule instead of rushing to catch up
+            m_next_frame = now;
+            return;
+        }
+
+        if (m_next_frame - now > margin)
+            std::this_thread::sleep_until(m_next_frame - margin);
+        while (clock::now() < m_next_frame)
+            std::this_thread::yield();
+    }
+};
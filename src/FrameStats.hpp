@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Rolling frame time statistics over the last window_size frames.
+ * Percentiles come from a log-bucketed histogram that is updated as frames enter and leave
+ * the window, and everything is stored inline so adding frames never allocates.
+ *
+ */
+class FrameStats
+{
+public:
+    static constexpr size_t window_size = 240;
+    static constexpr size_t bucket_count = 256;
+    static constexpr float histogram_min_ms = 0.05f;
+    static constexpr float histogram_max_ms = 2000.0f;
+
+    struct Summary
+    {
+        float min_ms = 0.0f;
+        float avg_ms = 0.0f;
+        float p50_ms = 0.0f;
+        float p95_ms = 0.0f;
+        float p99_ms = 0.0f;
+        float max_ms = 0.0f;
+        uint32_t hitches = 0; // hitches still inside the window
+    };
+
+private:
+    std::array<float, window_size> m_samples{};
+    std::array<bool, window_size> m_is_hitch{};
+    std::array<uint32_t, bucket_count> m_buckets{};
+    size_t m_next = 0; // slot the next frame is written to
+    size_t m_count = 0;
+    double m_sum_ms = 0.0;
+    uint32_t m_window_hitches = 0;
+    uint64_t m_total_frames = 0;
+    uint64_t m_total_hitches = 0;
+    float m_hitch_factor;
+
+    static float log_ratio() { return std::log(histogram_max_ms / histogram_min_ms) / bucket_count; }
+
+    static size_t bucket_of(float ms)
+    {
+        if (ms <= histogram_min_ms)
+            return 0;
+        size_t bucket = static_cast<size_t>(std::log(ms / histogram_min_ms) / log_ratio());
+        return std::min(bucket, bucket_count - 1);
+    }
+
+    static float bucket_lower(size_t bucket) { return histogram_min_ms * std::exp(log_ratio() * bucket); }
+
+public:
+    /**
+     * @param hitch_factor A frame counts as a hitch when it takes this many times longer than the median
+     */
+    FrameStats(float hitch_factor = 2.0f) : m_hitch_factor(hitch_factor) {}
+
+    /**
+     * @brief Records one frame
+     *
+     * @param seconds Frame duration in seconds
+     */
+    void add_frame(float seconds)
+    {
+        float ms = seconds * 1000.0f;
+
+        if (m_count == window_size)
+        {
+            float evicted = m_samples[m_next];
+            m_buckets[bucket_of(evicted)]--;
+            m_sum_ms -= evicted;
+            if (m_is_hitch[m_next])
+                m_window_hitches--;
+        }
+        else
+        {
+            m_count++;
+        }
+
+        // Judge against the median before this frame is included, so a hitch can't hide itself
+        bool hitch = m_count > 1 && ms > m_hitch_factor * percentile(0.5f);
+
+        m_samples[m_next] = ms;
+        m_is_hitch[m_next] = hitch;
+        m_buckets[bucket_of(ms)]++;
+        m_sum_ms += ms;
+        m_total_frames++;
+        if (hitch)
+        {
+            m_window_hitches++;
+            m_total_hitches++;
+        }
+
+        m_next = (m_next + 1) % window_size;
+    }
+
+    /**
+     * @brief Approximates a percentile of the frame times in the window from the histogram
+     *
+     * @param p Fraction in [0, 1]
+     * @return float Frame time in milliseconds
+     */
+    float percentile(float p) const
+    {
+        uint32_t in_histogram = 0;
+        for (uint32_t b : m_buckets)
+            in_histogram += b;
+        if (in_histogram == 0)
+            return 0.0f;
+
+        float target = p * in_histogram;
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < bucket_count; i++)
+        {
+            if (m_buckets[i] == 0)
+                continue;
+            if (cumulative + m_buckets[i] >= target)
+            {
+                // Interpolate geometrically inside the bucket
+                float t = (target - cumulative) / m_buckets[i];
+                return bucket_lower(i) * std::exp(log_ratio() * t);
+            }
+            cumulative += m_buckets[i];
+        }
+        return bucket_lower(bucket_count);
+    }
+
+    Summary summary() const
+    {
+        Summary s;
+        if (m_count == 0)
+            return s;
+
+        s.min_ms = s.max_ms = m_samples[0];
+        for (size_t i = 0; i < m_count; i++)
+        {
+            s.min_ms = std::min(s.min_ms, m_samples[i]);
+            s.max_ms = std::max(s.max_ms, m_samples[i]);
+        }
+        s.avg_ms = static_cast<float>(m_sum_ms / m_count);
+        // Bucket interpolation can overshoot the real extremes
+        s.p50_ms = std::clamp(percentile(0.50f), s.min_ms, s.max_ms);
+        s.p95_ms = std::clamp(percentile(0.95f), s.min_ms, s.max_ms);
+        s.p99_ms = std::clamp(percentile(0.99f), s.min_ms, s.max_ms);
+        s.hitches = m_window_hitches;
+        return s;
+    }
+
+    /**
+     * @brief The raw window, oldest sample at offset() once the window is full, for ImGui::PlotLines
+     *
+     */
+    const float *samples() const { return m_samples.data(); }
+    size_t count() const { return m_count; }
+    size_t offset() const { return m_count == window_size ? m_next : 0; }
+
+    uint64_t total_frames() const { return m_total_frames; }
+    uint64_t total_hitches() const { return m_total_hitches; }
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Math.hpp"
+
+/**
+ * @brief On-disk layout of a paged geometry file.
+ *
+ * A header, a directory with one PageEntry per page, then each page's vertices (position and
+ * color, 6 floats like Vertex) followed by its 16 bit indices. Pages are spatially compact
+ * clusters of triangles with their own local vertex numbering, so any page can be read and
+ * uploaded on its own. Values are stored in native byte order.
+ *
+ */
+struct PageFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t page_count;
+    math::AABB bounds;
+};
+
+struct PageEntry
+{
+    math::AABB bounds;
+    uint64_t offset; // from the start of the file
+    uint32_t vertex_count;
+    uint32_t index_count;
+
+    size_t vertex_bytes() const { return static_cast<size_t>(vertex_count) * 6 * sizeof(GLfloat); }
+    size_t index_bytes() const { return static_cast<size_t>(index_count) * sizeof(GLushort); }
+    size_t bytes() const { return vertex_bytes() + index_bytes(); }
+};
+
+constexpr char page_file_magic[8] = {'G', 'E', 'P', 'A', 'G', 'E', 'S', '\0'};
+constexpr uint32_t page_file_version = 1;
+
+// Pages index their vertices with GLushort, three unique vertices per triangle at most
+constexpr size_t max_page_triangles = 65535 / 3;
+constexpr size_t max_page_vertices = 65536;
+
+inline uint64_t stream_size(std::ifstream &file)
+{
+    file.clear();
+    std::streamoff position = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    file.seekg(position);
+    return size < 0 ? 0 : static_cast<uint64_t>(size);
+}
+
+/**
+ * @brief Whether an entry's counts are addressable and its data lies inside a file of file_size bytes
+ *
+ * Counts come from the file, so this is checked before they size any allocation.
+ */
+inline bool page_entry_valid(const PageEntry &entry, uint64_t file_size)
+{
+    return entry.vertex_count <= max_page_vertices && entry.offset <= file_size &&
+           entry.bytes() <= file_size - entry.offset;
+}
+
+/**
+ * @brief Reads the header and directory of a paged geometry file
+ *
+ * Fails when the directory doesn't fit in the file. Entries aren't checked, see page_entry_valid().
+ *
+ * @param file_size Set to the size of the file when given
+ */
+inline bool read_page_directory(const std::string &path, PageFileHeader &header, std::vector<PageEntry> &entries,
+                                uint64_t *file_size = nullptr)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+    if (std::memcmp(header.magic, page_file_magic, sizeof(page_file_magic)) != 0 || header.version != page_file_version)
+        return false;
+
+    uint64_t size = stream_size(file);
+    if (file_size)
+        *file_size = size;
+    if (uint64_t(header.page_count) * sizeof(PageEntry) > size - sizeof(header))
+        return false;
+
+    entries.resize(header.page_count);
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(PageEntry)));
+}
+
+/**
+ * @brief Reads one page's vertex and index data from an open paged geometry file
+ *
+ * Fails for an entry outside the file and for indices past the page's vertices, which would
+ * otherwise reach glDrawElements.
+ */
+inline bool read_page(std::ifstream &file, const PageEntry &entry, std::vector<GLfloat> &vertices, std::vector<GLushort> &indices)
+{
+    if (!page_entry_valid(entry, stream_size(file)))
+        return false;
+
+    vertices.resize(static_cast<size_t>(entry.vertex_count) * 6);
+    indices.resize(entry.index_count);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(entry.offset));
+    file.read(reinterpret_cast<char *>(vertices.data()), entry.vertex_bytes());
+    file.read(reinterpret_cast<char *>(indices.data()), entry.index_bytes());
+    if (!file)
+        return false;
+
+    for (GLushort index : indices)
+    {
+        if (index >= entry.vertex_count)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Splits a triangle soup into spatial pages and writes them as a paged geometry file
+ *
+ * Triangles are split recursively at the median centroid along the longest axis until each
+ * page holds at most max_triangles, so pages are compact and written in spatial order.
+ *
+ * @param positions Vertex positions
+ * @param triangles Three indices into positions per triangle
+ * @param color Color given to every vertex
+ * @param max_triangles Triangles per page, clamped to what 16 bit indices can address
+ */
+inline bool write_geometry_pages(const std::string &path,
+                                 const std::vector<math::Vec3> &positions,
+                                 const std::vector<uint32_t> &triangles,
+                                 std::array<GLfloat, 3> color = {1.0f, 1.0f, 1.0f},
+                                 size_t max_triangles = 16384)
+{
+    max_triangles = std::max<size_t>(1, std::min(max_triangles, max_page_triangles));
+
+    for (uint32_t index : triangles)
+    {
+        if (index >= positions.size())
+            return false;
+    }
+
+    size_t triangle_count = triangles.size() / 3;
+    std::vector<math::Vec3> centroids(triangle_count);
+    std::vector<uint32_t> order(triangle_count);
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        const math::Vec3 &a = positions[triangles[3 * t]];
+        const math::Vec3 &b = positions[triangles[3 * t + 1]];
+        const math::Vec3 &c = positions[triangles[3 * t + 2]];
+        centroids[t] = (a + b + c) * (1.0f / 3.0f);
+        order[t] = static_cast<uint32_t>(t);
+    }
+
+    // Leaves as [begin, end) ranges of order, produced depth first so neighbours stay close in the file
+    std::vector<std::pair<size_t, size_t>> leaves;
+    std::vector<std::pair<size_t, size_t>> stack = {{0, triangle_count}};
+    while (!stack.empty())
+    {
+        auto [begin, end] = stack.back();
+        stack.pop_back();
+        if (end - begin <= max_triangles)
+        {
+            if (end > begin)
+                leaves.push_back({begin, end});
+            continue;
+        }
+
+        math::AABB box = {centroids[order[begin]], centroids[order[begin]]};
+        for (size_t i = begin; i < end; i++)
+        {
+            box.min = math::min(box.min, centroids[order[i]]);
+            box.max = math::max(box.max, centroids[order[i]]);
+        }
+        math::Vec3 extent = box.max - box.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        stack.push_back({mid, end});
+        stack.push_back({begin, mid});
+    }
+
+    PageFileHeader header{};
+    std::memcpy(header.magic, page_file_magic, sizeof(page_file_magic));
+    header.version = page_file_version;
+    header.page_count = static_cast<uint32_t>(leaves.size());
+    header.bounds = math::compute_bounds(positions.data(), positions.size());
+
+    std::vector<PageEntry> entries(leaves.size());
+
+    // The directory is written again once every page's offset is known
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(PageEntry));
+
+    // Global vertex to page-local index, valid when stamp matches the page being built
+    std::vector<GLushort> local_index(positions.size());
+    std::vector<uint32_t> stamp(positions.size(), UINT32_MAX);
+    std::vector<GLfloat> vertices;
+    std::vector<GLushort> indices;
+    std::vector<math::Vec3> page_positions;
+
+    uint64_t offset = sizeof(PageFileHeader) + entries.size() * sizeof(PageEntry);
+    for (size_t p = 0; p < leaves.size(); p++)
+    {
+        vertices.clear();
+        indices.clear();
+        page_positions.clear();
+
+        for (size_t i = leaves[p].first; i < leaves[p].second; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = triangles[3 * order[i] + k];
+                if (stamp[v] != p)
+                {
+                    stamp[v] = static_cast<uint32_t>(p);
+                    local_index[v] = static_cast<GLushort>(page_positions.size());
+                    const math::Vec3 &pos = positions[v];
+                    vertices.insert(vertices.end(), {pos.x, pos.y, pos.z, color[0], color[1], color[2]});
+                    page_positions.push_back(pos);
+                }
+                indices.push_back(local_index[v]);
+            }
+        }
+
+        PageEntry &entry = entries[p];
+        entry.bounds = math::compute_bounds(page_positions.data(), page_positions.size());
+        entry.offset = offset;
+        entry.vertex_count = static_cast<uint32_t>(page_positions.size());
+        entry.index_count = static_cast<uint32_t>(indices.size());
+        offset += entry.bytes();
+
+        file.write(reinterpret_cast<const char *>(vertices.data()), entry.vertex_bytes());
+        file.write(reinterpret_cast<const char *>(indices.data()), entry.index_bytes());
+    }
+
+    file.seekp(sizeof(PageFileHeader));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(PageEntry));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Writers for 8 bit RGB images, rows given top to bottom
+ *
+ */
+namespace image_file
+{
+
+inline const std::array<uint32_t, 256> &crc_table()
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+inline uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const std::array<uint32_t, 256> &table = crc_table();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline void put_u32(std::vector<uint8_t> &out, uint32_t v)
+{
+    out.insert(out.end(), {uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v)});
+}
+
+inline void write_chunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> header;
+    put_u32(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    uint32_t crc = crc32(crc32(0, header.data() + 4, 4), data.data(), data.size());
+    std::vector<uint8_t> footer;
+    put_u32(footer, crc);
+
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+}
+
+} // namespace image_file
+
+/**
+ * @brief Writes a binary PPM (P6)
+ *
+ */
+inline bool write_ppm(const std::string &path, int width, int height, const uint8_t *rgb)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+    file.write(reinterpret_cast<const char *>(rgb), size_t(width) * height * 3);
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Writes a PNG without compression
+ *
+ * The image data is zlib stored blocks, so this needs no deflate implementation and costs about
+ * as much as a copy; any PNG reader opens it. Files are as large as the raw pixels.
+ */
+inline bool write_png(const std::string &path, int width, int height, const uint8_t *rgb)
+{
+    using namespace image_file;
+
+    // Each row starts with filter type 0 (none)
+    size_t row_bytes = size_t(width) * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((row_bytes + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb + y * row_bytes, rgb + (y + 1) * row_bytes);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    size_t offset = 0;
+    do
+    {
+        size_t block = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + block == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.insert(zlib.end(), {uint8_t(block), uint8_t(block >> 8), uint8_t(~block), uint8_t(~block >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block);
+        offset += block;
+    } while (offset < raw.size());
+
+    // Adler-32, reduced only every 5552 bytes which is as long as the sums can't overflow
+    uint32_t adler_a = 1, adler_b = 0;
+    for (size_t start = 0; start < raw.size(); start += 5552)
+    {
+        size_t end = std::min(raw.size(), start + 5552);
+        for (size_t i = start; i < end; i++)
+        {
+            adler_a += raw[i];
+            adler_b += adler_a;
+        }
+        adler_a %= 65521;
+        adler_b %= 65521;
+    }
+    put_u32(zlib, (adler_b << 16) | adler_a);
+
+    std::vector<uint8_t> ihdr;
+    put_u32(ihdr, static_cast<uint32_t>(width));
+    put_u32(ihdr, static_cast<uint32_t>(height));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, deflate, no interlace
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+    write_chunk(file, "IHDR", ihdr);
+    write_chunk(file, "IDAT", zlib);
+    write_chunk(file, "IEND", {});
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Writes a PNG or PPM depending on the extension of path, PNG when it is neither
+ *
+ */
+inline bool write_image(const std::string &path, int width, int height, const uint8_t *rgb)
+{
+    std::string_view p(path);
+    if (p.size() >= 4 && (p.substr(p.size() - 4) == ".ppm" || p.substr(p.size() - 4) == ".PPM"))
+        return write_ppm(path, width, height, rgb);
+    return write_png(path, width, height, rgb);
+}
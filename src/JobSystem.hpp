@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Small thread pool for CPU-side engine work (BVH builds, culling, mesh processing).
+ *
+ * Work is submitted through a TaskGroup; a thread waiting on a group runs queued tasks itself
+ * instead of sleeping, so tasks may create and wait on nested groups without deadlocking.
+ *
+ */
+class JobSystem
+{
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    void worker_loop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_stop && m_queue.empty())
+                    return;
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    void push(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    /**
+     * @brief Runs one queued task on the calling thread, false if the queue was empty
+     *
+     */
+    bool try_run_one()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.empty())
+                return false;
+            task = std::move(m_queue.back()); // newest first, it is most likely still in cache
+            m_queue.pop_back();
+        }
+        task();
+        return true;
+    }
+
+public:
+    /**
+     * @param thread_count Worker threads, the thread that waits on work also takes part
+     */
+    JobSystem(unsigned thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1)
+    {
+        for (unsigned i = 0; i < thread_count; i++)
+            m_workers.emplace_back([this] { worker_loop(); });
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    /**
+     * @brief The pool shared by the engine's subsystems
+     *
+     */
+    static JobSystem &shared()
+    {
+        static JobSystem system;
+        return system;
+    }
+
+    /**
+     * @brief Number of threads that can work at once, including the waiting thread
+     *
+     */
+    size_t concurrency() const { return m_workers.size() + 1; }
+
+    /**
+     * @brief A set of tasks that can be waited on together
+     *
+     */
+    class TaskGroup
+    {
+        JobSystem &m_system;
+        std::atomic<size_t> m_pending{0};
+
+    public:
+        TaskGroup(JobSystem &system = JobSystem::shared()) : m_system(system) {}
+        ~TaskGroup() { wait(); }
+
+        template <typename Fn>
+        void run(Fn &&fn)
+        {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            m_system.push([this, fn = std::forward<Fn>(fn)]() mutable {
+                fn();
+                m_pending.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        /**
+         * @brief Blocks until every task in the group finished, running queued tasks meanwhile
+         *
+         */
+        void wait()
+        {
+            while (m_pending.load(std::memory_order_acquire) > 0)
+            {
+                if (!m_system.try_run_one())
+                    std::this_thread::yield();
+            }
+        }
+    };
+
+    /**
+     * @brief Calls fn(chunk_begin, chunk_end) over [begin, end) in chunks of at least grain items
+     *
+     */
+    template <typename Fn>
+    void parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn)
+    {
+        if (end <= begin)
+            return;
+        size_t count = end - begin;
+        size_t chunks = std::min(concurrency() * 4, (count + grain - 1) / std::max<size_t>(grain, 1));
+        if (chunks <= 1)
+        {
+            fn(begin, end);
+            return;
+        }
+
+        size_t chunk_size = (count + chunks - 1) / chunks;
+        TaskGroup group(*this);
+        for (size_t b = begin + chunk_size; b < end; b += chunk_size)
+        {
+            size_t e = std::min(end, b + chunk_size);
+            group.run([&fn, b, e] { fn(b, e); });
+        }
+        fn(begin, std::min(end, begin + chunk_size));
+        group.wait();
+    }
+};
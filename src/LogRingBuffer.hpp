@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Fixed capacity store of text lines, oldest lines are dropped once either the line
+ * or the text budget is used up. All text lives in one contiguous arena so nothing is
+ * allocated after construction, and each line is kept unbroken so it can be handed to ImGui as is.
+ *
+ */
+class LogRingBuffer
+{
+    struct LineRef
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<char> m_arena;
+    std::vector<LineRef> m_lines;
+    size_t m_first = 0; // slot of the oldest line in m_lines
+    size_t m_count = 0;
+    size_t m_write = 0; // next free byte in m_arena
+
+    const LineRef &oldest() const { return m_lines[m_first]; }
+
+    void pop_oldest()
+    {
+        m_first = (m_first + 1) % m_lines.size();
+        m_count--;
+    }
+
+public:
+    LogRingBuffer(size_t max_lines = 2048, size_t arena_bytes = 256 * 1024)
+        : m_arena(std::max<size_t>(arena_bytes, 1)), m_lines(std::max<size_t>(max_lines, 1))
+    {
+    }
+
+    /**
+     * @brief Appends a line, evicting the oldest lines as needed. Lines longer than the arena are truncated
+     *
+     * @param text The line to append
+     */
+    void push(std::string_view text)
+    {
+        size_t length = std::min(text.size(), m_arena.size());
+        // Every line takes at least one byte so empty lines still have a position in the arena
+        size_t footprint = std::max<size_t>(length, 1);
+
+        if (m_write + footprint > m_arena.size())
+        {
+            // The tail can't hold it: drop the lines left in the tail from the previous lap and wrap
+            while (m_count > 0 && oldest().offset >= m_write)
+                pop_oldest();
+            m_write = 0;
+        }
+
+        while (m_count > 0 && oldest().offset < m_write + footprint &&
+               oldest().offset + std::max<uint32_t>(oldest().length, 1) > m_write)
+            pop_oldest();
+
+        if (m_count == m_lines.size())
+            pop_oldest();
+
+        std::copy_n(text.data(), length, m_arena.data() + m_write);
+        m_lines[(m_first + m_count) % m_lines.size()] = {static_cast<uint32_t>(m_write), static_cast<uint32_t>(length)};
+        m_count++;
+        m_write += footprint;
+    }
+
+    /**
+     * @brief Returns a line, 0 being the oldest one still stored
+     *
+     */
+    std::string_view line(size_t index) const
+    {
+        const LineRef &ref = m_lines[(m_first + index) % m_lines.size()];
+        return std::string_view(m_arena.data() + ref.offset, ref.length);
+    }
+
+    size_t size() const { return m_count; }
+
+    size_t capacity() const { return m_lines.size(); }
+
+    void clear()
+    {
+        m_first = 0;
+        m_count = 0;
+        m_write = 0;
+    }
+};
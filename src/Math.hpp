@@ -0,0 +1,423 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// SSE is baseline on x86-64, AVX only when the compiler is allowed to use it (-mavx).
+// Define MATH_FORCE_SCALAR to build the plain C++ paths instead.
+#if !defined(MATH_FORCE_SCALAR) && (defined(__SSE__) || defined(_M_X64))
+#define MATH_SSE 1
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define MATH_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+/**
+ * @brief Vector and matrix types shared by the camera, renderer and geometry code.
+ *
+ * Matrices are column-major, the layout OpenGL expects, so data() can be handed straight to
+ * glUniformMatrix4fv. Every SIMD kernel performs the same float operations in the same order as
+ * its scalar fallback (multiplies first, then adds left to right, no fused multiply-add), so the
+ * SSE, AVX and scalar builds produce bit-identical results as long as the compiler isn't allowed
+ * to contract expressions into FMAs (-ffp-contract=off).
+ *
+ */
+namespace math
+{
+
+struct Vec3
+{
+    float x, y, z;
+
+    Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+    Vec3 &operator+=(const Vec3 &o) { return *this = *this + o; }
+    Vec3 &operator-=(const Vec3 &o) { return *this = *this - o; }
+    float operator[](int i) const { return (&x)[i]; }
+    float &operator[](int i) { return (&x)[i]; }
+};
+
+struct alignas(16) Vec4
+{
+    float x, y, z, w;
+
+    float operator[](int i) const { return (&x)[i]; }
+    float &operator[](int i) { return (&x)[i]; }
+};
+
+struct alignas(16) Mat4
+{
+    Vec4 cols[4];
+
+    static Mat4 identity()
+    {
+        return {{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}}};
+    }
+
+    Vec4 &operator[](int col) { return cols[col]; }
+    const Vec4 &operator[](int col) const { return cols[col]; }
+
+    float *data() { return &cols[0].x; }
+    const float *data() const { return &cols[0].x; }
+
+    bool operator==(const Mat4 &o) const { return std::memcmp(this, &o, sizeof(Mat4)) == 0; }
+    bool operator!=(const Mat4 &o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Axis aligned bounding box
+ *
+ */
+struct AABB
+{
+    Vec3 min;
+    Vec3 max;
+
+    Vec3 center() const { return (min + max) * 0.5f; }
+    Vec3 extent() const { return (max - min) * 0.5f; }
+};
+
+inline float radians(float degrees) { return degrees * 0.01745329251994329577f; }
+
+inline float dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline float length(const Vec3 &v) { return std::sqrt(dot(v, v)); }
+
+inline Vec3 normalize(const Vec3 &v)
+{
+    float len = length(v);
+    if (len == 0.0f)
+        return {0.0f, 0.0f, 0.0f};
+    return v * (1.0f / len);
+}
+
+inline Vec3 min(const Vec3 &a, const Vec3 &b)
+{
+    return {a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z};
+}
+
+inline Vec3 max(const Vec3 &a, const Vec3 &b)
+{
+    return {a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z};
+}
+
+namespace detail
+{
+#if MATH_SSE
+inline __m128 load(const Vec4 &v) { return _mm_load_ps(&v.x); }
+inline void store(Vec4 &v, __m128 r) { _mm_store_ps(&v.x, r); }
+
+/**
+ * @brief ((c0 * x + c1 * y) + c2 * z) + c3 * w, the one combination every kernel is built on
+ *
+ */
+inline __m128 combine(__m128 c0, __m128 c1, __m128 c2, __m128 c3, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), _mm_mul_ps(c2, z)), _mm_mul_ps(c3, w));
+}
+#endif
+
+inline Vec4 combine_scalar(const Mat4 &m, float x, float y, float z, float w)
+{
+    Vec4 r;
+    for (int i = 0; i < 4; i++)
+        r[i] = ((m.cols[0][i] * x + m.cols[1][i] * y) + m.cols[2][i] * z) + m.cols[3][i] * w;
+    return r;
+}
+} // namespace detail
+
+inline Mat4 operator*(const Mat4 &a, const Mat4 &b)
+{
+    Mat4 r;
+#if MATH_SSE
+    __m128 a0 = detail::load(a.cols[0]), a1 = detail::load(a.cols[1]);
+    __m128 a2 = detail::load(a.cols[2]), a3 = detail::load(a.cols[3]);
+    for (int j = 0; j < 4; j++)
+    {
+        const Vec4 &c = b.cols[j];
+        detail::store(r.cols[j], detail::combine(a0, a1, a2, a3, _mm_set1_ps(c.x), _mm_set1_ps(c.y),
+                                                 _mm_set1_ps(c.z), _mm_set1_ps(c.w)));
+    }
+#else
+    for (int j = 0; j < 4; j++)
+        r.cols[j] = detail::combine_scalar(a, b.cols[j].x, b.cols[j].y, b.cols[j].z, b.cols[j].w);
+#endif
+    return r;
+}
+
+inline Vec4 operator*(const Mat4 &m, const Vec4 &v)
+{
+#if MATH_SSE
+    Vec4 r;
+    detail::store(r, detail::combine(detail::load(m.cols[0]), detail::load(m.cols[1]), detail::load(m.cols[2]),
+                                     detail::load(m.cols[3]), _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z),
+                                     _mm_set1_ps(v.w)));
+    return r;
+#else
+    return detail::combine_scalar(m, v.x, v.y, v.z, v.w);
+#endif
+}
+
+/**
+ * @brief Transforms a point (w = 1), without the perspective divide
+ *
+ */
+inline Vec3 transform_point(const Mat4 &m, const Vec3 &p)
+{
+    Vec4 r = m * Vec4{p.x, p.y, p.z, 1.0f};
+    return {r.x, r.y, r.z};
+}
+
+/**
+ * @brief Transforms a direction (w = 0), translation is ignored
+ *
+ */
+inline Vec3 transform_vector(const Mat4 &m, const Vec3 &v)
+{
+    Vec4 r = m * Vec4{v.x, v.y, v.z, 0.0f};
+    return {r.x, r.y, r.z};
+}
+
+/**
+ * @brief General 4x4 inverse by cofactors, the identity if m is singular
+ *
+ */
+inline Mat4 inverse(const Mat4 &m)
+{
+    const float *a = m.data();
+    float inv[16];
+
+    inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+    inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+    inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+    inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+    inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+    inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+    inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+    inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+    inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+    inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+    inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+    inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+    inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+    inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+    inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+    inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+    float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+    if (det == 0.0f)
+        return Mat4::identity();
+
+    Mat4 r;
+    float inv_det = 1.0f / det;
+    for (int i = 0; i < 16; i++)
+        r.data()[i] = inv[i] * inv_det;
+    return r;
+}
+
+/**
+ * @brief Right handed view matrix, same convention as glm::lookAt
+ *
+ */
+inline Mat4 look_at(const Vec3 &eye, const Vec3 &center, const Vec3 &up)
+{
+    Vec3 f = normalize(center - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+
+    Mat4 m = Mat4::identity();
+    m[0] = {s.x, u.x, -f.x, 0.0f};
+    m[1] = {s.y, u.y, -f.y, 0.0f};
+    m[2] = {s.z, u.z, -f.z, 0.0f};
+    m[3] = {-dot(s, eye), -dot(u, eye), dot(f, eye), 1.0f};
+    return m;
+}
+
+/**
+ * @brief Right handed perspective projection with a [-1, 1] depth range, same as glm::perspective
+ *
+ * @param fovy Vertical field of view in radians
+ */
+inline Mat4 perspective(float fovy, float aspect, float near_plane, float far_plane)
+{
+    float f = 1.0f / std::tan(fovy * 0.5f);
+    Mat4 m{};
+    m[0].x = f / aspect;
+    m[1].y = f;
+    m[2].z = (far_plane + near_plane) / (near_plane - far_plane);
+    m[2].w = -1.0f;
+    m[3].z = (2.0f * far_plane * near_plane) / (near_plane - far_plane);
+    return m;
+}
+
+inline Mat4 translate(const Vec3 &t)
+{
+    Mat4 m = Mat4::identity();
+    m[3] = {t.x, t.y, t.z, 1.0f};
+    return m;
+}
+
+inline Mat4 scale(const Vec3 &s)
+{
+    Mat4 m = Mat4::identity();
+    m[0].x = s.x;
+    m[1].y = s.y;
+    m[2].z = s.z;
+    return m;
+}
+
+/**
+ * @brief Rotation around the y axis
+ *
+ * @param angle Angle in radians
+ */
+inline Mat4 rotate_y(float angle)
+{
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    Mat4 m = Mat4::identity();
+    m[0] = {c, 0.0f, -s, 0.0f};
+    m[2] = {s, 0.0f, c, 0.0f};
+    return m;
+}
+
+/**
+ * @brief out[i] = a[i] * b[i] for n matrices
+ *
+ */
+inline void mul_batch(const Mat4 *a, const Mat4 *b, Mat4 *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = a[i] * b[i];
+}
+
+/**
+ * @brief out[i] = a * b[i] for n matrices, e.g. applying a parent or view-projection to many objects
+ *
+ */
+inline void mul_batch(const Mat4 &a, const Mat4 *b, Mat4 *out, size_t n)
+{
+#if MATH_AVX
+    // Two output columns per iteration, each 128-bit lane doing exactly what the SSE path does
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.cols[0]));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.cols[1]));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.cols[2]));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.cols[3]));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (int j = 0; j < 4; j += 2)
+        {
+            const Vec4 &c0 = b[i].cols[j];
+            const Vec4 &c1 = b[i].cols[j + 1];
+            __m256 x = _mm256_setr_ps(c0.x, c0.x, c0.x, c0.x, c1.x, c1.x, c1.x, c1.x);
+            __m256 y = _mm256_setr_ps(c0.y, c0.y, c0.y, c0.y, c1.y, c1.y, c1.y, c1.y);
+            __m256 z = _mm256_setr_ps(c0.z, c0.z, c0.z, c0.z, c1.z, c1.z, c1.z, c1.z);
+            __m256 w = _mm256_setr_ps(c0.w, c0.w, c0.w, c0.w, c1.w, c1.w, c1.w, c1.w);
+            __m256 r = _mm256_add_ps(
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a0, x), _mm256_mul_ps(a1, y)), _mm256_mul_ps(a2, z)),
+                _mm256_mul_ps(a3, w));
+            _mm256_storeu_ps(&out[i].cols[j].x, r);
+        }
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+        out[i] = a * b[i];
+#endif
+}
+
+/**
+ * @brief Transforms n points by one matrix (w = 1, no perspective divide). in and out may alias
+ *
+ */
+inline void transform_points(const Mat4 &m, const Vec3 *in, Vec3 *out, size_t n)
+{
+#if MATH_SSE
+    __m128 c0 = detail::load(m.cols[0]), c1 = detail::load(m.cols[1]);
+    __m128 c2 = detail::load(m.cols[2]), c3 = detail::load(m.cols[3]);
+    __m128 one = _mm_set1_ps(1.0f);
+    for (size_t i = 0; i < n; i++)
+    {
+        Vec3 p = in[i];
+        alignas(16) float r[4];
+        _mm_store_ps(r, detail::combine(c0, c1, c2, c3, _mm_set1_ps(p.x), _mm_set1_ps(p.y), _mm_set1_ps(p.z), one));
+        out[i] = {r[0], r[1], r[2]};
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+        out[i] = transform_point(m, in[i]);
+#endif
+}
+
+/**
+ * @brief Transforms n boxes by one matrix, giving the boxes that enclose the transformed corners
+ * (Arvo's method: each column contributes its smaller and larger product to min and max)
+ *
+ */
+inline void transform_aabbs(const Mat4 &m, const AABB *in, AABB *out, size_t n)
+{
+#if MATH_SSE
+    __m128 c[3] = {detail::load(m.cols[0]), detail::load(m.cols[1]), detail::load(m.cols[2])};
+    __m128 t = detail::load(m.cols[3]);
+    for (size_t i = 0; i < n; i++)
+    {
+        AABB box = in[i];
+        __m128 lo = t, hi = t;
+        for (int k = 0; k < 3; k++)
+        {
+            __m128 a = _mm_mul_ps(c[k], _mm_set1_ps(box.min[k]));
+            __m128 b = _mm_mul_ps(c[k], _mm_set1_ps(box.max[k]));
+            lo = _mm_add_ps(lo, _mm_min_ps(a, b));
+            hi = _mm_add_ps(hi, _mm_max_ps(a, b));
+        }
+        alignas(16) float l[4], h[4];
+        _mm_store_ps(l, lo);
+        _mm_store_ps(h, hi);
+        out[i] = {{l[0], l[1], l[2]}, {h[0], h[1], h[2]}};
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+    {
+        AABB box = in[i];
+        Vec3 lo = {m.cols[3].x, m.cols[3].y, m.cols[3].z};
+        Vec3 hi = lo;
+        for (int k = 0; k < 3; k++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float a = m.cols[k][axis] * box.min[k];
+                float b = m.cols[k][axis] * box.max[k];
+                // Same operand order as _mm_min_ps / _mm_max_ps
+                lo[axis] = lo[axis] + (a < b ? a : b);
+                hi[axis] = hi[axis] + (a > b ? a : b);
+            }
+        }
+        out[i] = {lo, hi};
+    }
+#endif
+}
+
+/**
+ * @brief Bounds of n points, an empty (inverted) box when n is 0
+ *
+ */
+inline AABB compute_bounds(const Vec3 *points, size_t n)
+{
+    AABB box = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+    for (size_t i = 0; i < n; i++)
+    {
+        box.min = min(box.min, points[i]);
+        box.max = max(box.max, points[i]);
+    }
+    return box;
+}
+
+} // namespace math
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <utility>
 #include <vector>
 
 #include "Vertex.hpp"
@@ -14,7 +15,7 @@ struct Mesh
 	std::vector<Vertex> vertices;
 	std::vector<GLushort> indices;
 
-	Mesh(std::vector<Vertex> vertices, std::vector<GLushort> indices) : vertices(vertices), indices(indices) {}
+	Mesh(std::vector<Vertex> vertices, std::vector<GLushort> indices) : vertices(std::move(vertices)), indices(std::move(indices)) {}
 
 	template <size_t vertex_num, size_t index_count>
 	Mesh(std::array<GLfloat, vertex_num> positions,
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free multi-producer queue of short text messages (Vyukov's bounded queue).
+ * Any thread may push, one thread drains. Messages are copied into fixed slots, so pushing never
+ * allocates; when the queue is full the message is dropped and counted instead of blocking.
+ *
+ */
+class MessageQueue
+{
+public:
+    static constexpr size_t max_message_length = 240;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        uint32_t length;
+        char text[max_message_length];
+    };
+
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueue_pos{0};
+    alignas(64) std::atomic<size_t> m_dequeue_pos{0};
+    alignas(64) std::atomic<size_t> m_dropped{0};
+
+    static size_t round_up_pow2(size_t n)
+    {
+        size_t p = 2;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+public:
+    /**
+     * @param capacity Number of message slots, rounded up to a power of two
+     */
+    MessageQueue(size_t capacity = 1024) : m_cells(round_up_pow2(capacity)), m_mask(m_cells.size() - 1)
+    {
+        for (size_t i = 0; i < m_cells.size(); i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MessageQueue(const MessageQueue &) = delete;
+    MessageQueue &operator=(const MessageQueue &) = delete;
+
+    /**
+     * @brief Copies a message into the queue, safe to call from any thread. Long messages are truncated
+     *
+     * @return false if the queue was full and the message was dropped
+     */
+    bool try_push(std::string_view message)
+    {
+        Cell *cell;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->length = static_cast<uint32_t>(std::min(message.size(), max_message_length));
+        std::copy_n(message.data(), cell->length, cell->text);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pops every message currently available and hands it to fn as a std::string_view.
+     * Only one thread may drain at a time
+     *
+     * @return The number of messages drained
+     */
+    template <typename Fn>
+    size_t drain(Fn &&fn)
+    {
+        size_t count = 0;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = m_cells[pos & m_mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0)
+                break; // empty, or the producer hasn't finished writing yet
+
+            fn(std::string_view(cell.text, cell.length));
+            cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            pos++;
+            count++;
+        }
+        m_dequeue_pos.store(pos, std::memory_order_relaxed);
+        return count;
+    }
+
+    /**
+     * @brief Whether there is nothing to drain, only a hint while producers are active
+     *
+     */
+    bool empty() const
+    {
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        size_t seq = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+        return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0;
+    }
+
+    /**
+     * @brief Number of messages dropped because the queue was full
+     *
+     */
+    size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+};
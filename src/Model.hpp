@@ -2,21 +2,71 @@
 
 #include <array>
 #include <iostream>
-#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
 
 
 #include <GL/glew.h>
 
+#include "BVH.hpp"
+#include "EdgeList.hpp"
+#include "Math.hpp"
 #include "Mesh.hpp"
 #include "Vertex.hpp"
 
+/**
+ * @brief The OpenGL objects of an uploaded mesh, deleted when the last model sharing them goes away
+ *
+ */
+struct GpuBuffers
+{
+	GLuint vao = 0;
+	GLuint vbos[2] = {0, 0};
+	GLuint ebo = 0;
+	size_t bytes = 0; // uploaded buffer sizes
+
+	// Unique edges for GL_LINES, only after Model::build_edges()
+	GLuint edge_vao = 0;
+	GLuint edge_ebo = 0;
+	GLsizei edge_index_count = 0;
+
+	GpuBuffers() = default;
+	GpuBuffers(const GpuBuffers &) = delete;
+	GpuBuffers &operator=(const GpuBuffers &) = delete;
+
+	~GpuBuffers()
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(2, vbos);
+		glDeleteBuffers(1, &ebo);
+		glDeleteVertexArrays(1, &edge_vao);
+		glDeleteBuffers(1, &edge_ebo);
+	}
+};
+
 class Model
 {
-	Mesh m_mesh;
-	GLuint m_vao;
-	GLuint m_vbos[2];
-	GLuint m_ebo;
-	bool should_be_destroyed;
+	std::shared_ptr<const Mesh> m_mesh; // CPU copy shared with instances, null after release_cpu_mesh()
+	std::shared_ptr<GpuBuffers> m_buffers;
+	GLsizei m_index_count;
+	size_t m_vertex_count;
+	math::AABB m_bounds;
+
+	/**
+	 * @brief Model space bounds of the mesh, used by culling
+	 *
+	 */
+	void compute_bounds()
+	{
+		m_bounds = {math::Vec3{INFINITY, INFINITY, INFINITY}, math::Vec3{-INFINITY, -INFINITY, -INFINITY}};
+		for (const auto &vertex : m_mesh->vertices)
+		{
+			math::Vec3 p = {vertex.position[0], vertex.position[1], vertex.position[2]};
+			m_bounds.min = math::min(m_bounds.min, p);
+			m_bounds.max = math::max(m_bounds.max, p);
+		}
+	}
 
 	/**
 	 * @brief Set the up OpenGL buffers (vbo for position, vbo for color, ebo for indices, and vao to store buffers)
@@ -24,119 +74,198 @@ class Model
 	 */
 	void setup_opengl_bs()
 	{
-		glGenVertexArrays(1, &m_vao);
-		glGenBuffers(2, m_vbos);
+		const Mesh &mesh = *m_mesh;
+		m_buffers = std::make_shared<GpuBuffers>();
+		GpuBuffers &b = *m_buffers;
 
-		glBindVertexArray(m_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+		glGenVertexArrays(1, &b.vao);
+		glGenBuffers(2, b.vbos);
+
+		glBindVertexArray(b.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, b.vbos[0]);
 		glBufferData(GL_ARRAY_BUFFER,
-			     m_mesh.vertices.size() * sizeof(Vertex),
-			     m_mesh.vertices.data(),
+			     mesh.vertices.size() * sizeof(Vertex),
+			     mesh.vertices.data(),
 			     GL_STATIC_DRAW); //
 
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
 		glEnableVertexAttribArray(0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbos[1]);
+		glBindBuffer(GL_ARRAY_BUFFER, b.vbos[1]);
 		glBufferData(GL_ARRAY_BUFFER,
-			     m_mesh.vertices.size() * sizeof(Vertex),
-			     m_mesh.vertices.data(),
+			     mesh.vertices.size() * sizeof(Vertex),
+			     mesh.vertices.data(),
 			     GL_STATIC_DRAW); //
 
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
 		glEnableVertexAttribArray(1);
 
-		glGenBuffers(1, &m_ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		glGenBuffers(1, &b.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.ebo);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-			     m_mesh.indices.size() * sizeof(GLushort),
-			     m_mesh.indices.data(),
+			     mesh.indices.size() * sizeof(GLushort),
+			     mesh.indices.data(),
 			     GL_STATIC_DRAW);
+
+		b.bytes = 2 * mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(GLushort);
+	}
+
+	void init()
+	{
+		m_index_count = static_cast<GLsizei>(m_mesh->indices.size());
+		m_vertex_count = m_mesh->vertices.size();
+		setup_opengl_bs();
+		compute_bounds();
+	}
+
+	/**
+	 * @brief Another model drawing the same GPU buffers and sharing the CPU mesh if there still is one
+	 *
+	 */
+	Model(const Model &shared_from, bool)
+	    : m_mesh(shared_from.m_mesh), m_buffers(shared_from.m_buffers), m_index_count(shared_from.m_index_count),
+	      m_vertex_count(shared_from.m_vertex_count), m_bounds(shared_from.m_bounds), bvh(shared_from.bvh)
+	{
 	}
 
     public:
 	friend class Renderer;
 
+	math::Mat4 transform = math::Mat4::identity(); // model to world, before the renderer's spin
+	std::shared_ptr<const BVH> bvh;                // only present after build_bvh(), shared by instances
+	bool occluder = false;                         // rasterized into the occlusion buffer (needs the CPU mesh), never culled itself
+
 	template <size_t vertex_num, size_t index_count>
 	Model(std::array<GLfloat, vertex_num> positions,
 	      std::array<GLfloat, vertex_num> colors,
 	      std::array<GLushort, index_count> indices)
-	    : m_mesh(positions, colors, indices), should_be_destroyed(true)
+	    : m_mesh(std::make_shared<const Mesh>(positions, colors, indices))
 	{
-		setup_opengl_bs();
+		init();
 	}
 
-	Model(Mesh m) : m_mesh(m), should_be_destroyed(true) { setup_opengl_bs(); }
+	Model(Mesh m) : m_mesh(std::make_shared<const Mesh>(std::move(m))) { init(); }
 
-	Model(Model &&other) : m_mesh(other.m_mesh), m_vao(other.m_vao), should_be_destroyed(true)
-	{
-		std::memcpy(this->m_vbos, other.m_vbos, 2 * sizeof(GLuint));
-		other.m_vao = 0;
-		std::memset(other.m_vbos, 0, 2 * sizeof(GLuint));
-		other.should_be_destroyed = false;
-	}
+	/**
+	 * @brief Destructive move - A model should have unique information, so copying models doesn;t really make sense.
+	 * Use instance() to draw the same buffers more than once.
+	 *
+	 */
+	Model(Model &&other) = default;
+	Model &operator=(Model &&other) = default;
 
 	/**
-	 * @brief Destructive move - A model should have unique information, so copying models doesn;t really make sense
+	 * @brief A new model sharing this one's GPU buffers and BVH, with its own transform
 	 *
-	 * @param other Other model to move from
-	 * @return Model&
 	 */
-	Model &operator=(Model &&other)
+	Model instance() const { return Model(*this, true); }
+
+	/**
+	 * @brief Builds the BVH used for picking and geometry queries, needs the CPU mesh
+	 *
+	 */
+	void build_bvh() { bvh = std::make_shared<const BVH>(*m_mesh); }
+
+	/**
+	 * @brief Builds the deduplicated edge list drawn in GL_LINES mode, shared by instances, needs the CPU mesh
+	 *
+	 */
+	void build_edges()
 	{
-		if (&other == this)
+		std::vector<GLushort> edges = build_edge_list(m_mesh->indices);
+		GpuBuffers &b = *m_buffers;
+		if (!b.edge_vao)
 		{
-			return *this;
+			glGenVertexArrays(1, &b.edge_vao);
+			glGenBuffers(1, &b.edge_ebo);
 		}
-		this->cleanup();
+		else
+			b.bytes -= b.edge_index_count * sizeof(GLushort);
 
-		this->m_mesh = other.m_mesh;
-		this->m_vao = other.m_vao;
-		this->should_be_destroyed = true;
-		std::memcpy(this->m_vbos, other.m_vbos, 2 * sizeof(GLuint));
+		// Same vertex buffers as the triangles, only the element buffer differs
+		glBindVertexArray(b.edge_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, b.vbos[0]);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, b.vbos[1]);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(1);
 
-		other.m_vao = 0;
-		other.should_be_destroyed = false;
-		std::memset(other.m_vbos, 0, 2 * sizeof(GLuint));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.edge_ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, edges.size() * sizeof(GLushort), edges.data(), GL_STATIC_DRAW);
+		glBindVertexArray(0);
 
-		return *this;
+		b.edge_index_count = static_cast<GLsizei>(edges.size());
+		b.bytes += edges.size() * sizeof(GLushort);
 	}
 
+	GLsizei edge_index_count() const { return m_buffers ? m_buffers->edge_index_count : 0; }
+
+	/**
+	 * @brief Drops this model's CPU copy of the mesh, drawing only needs the GPU buffers and the counts kept here
+	 *
+	 * The copy is freed once no instance shares it. Occluders, build_bvh() and build_edges() read
+	 * the CPU mesh, so release it after those.
+	 */
+	void release_cpu_mesh() { m_mesh.reset(); }
+
 	/**
-	 * @brief Deletes buffers and vao
+	 * @brief Gives back a CPU copy dropped by release_cpu_mesh(), only instances made afterwards share it
 	 *
+	 * @return false, keeping no copy, if the mesh doesn't match the uploaded buffers
 	 */
-	void cleanup()
+	bool restore_cpu_mesh(Mesh mesh)
 	{
-		glDeleteVertexArrays(1, &m_vao);
-		glDeleteBuffers(2, m_vbos);
-		glDeleteBuffers(1, &m_ebo);
-		should_be_destroyed = false;
+		if (mesh.vertices.size() != m_vertex_count || mesh.indices.size() != static_cast<size_t>(m_index_count))
+			return false;
+		m_mesh = std::make_shared<const Mesh>(std::move(mesh));
+		return true;
 	}
 
+	bool has_cpu_mesh() const { return m_mesh != nullptr; }
+	const Mesh *mesh() const { return m_mesh.get(); }
+	const math::AABB &bounds() const { return m_bounds; }
+	GLsizei index_count() const { return m_index_count; }
+	size_t vertex_count() const { return m_vertex_count; }
+
 	/**
-	 * @brief Prints simple info, like memory address, vao id, vbos id, num vertices, and num indices
+	 * @brief Bytes of the CPU mesh copy and BVH held by this model, both possibly shared with instances
 	 *
 	 */
-	void print_debug_info()
+	size_t cpu_bytes() const
 	{
-		std::cout << "Model " << this << " info:\n";
-		std::cout << '\t' << this->m_vao << '\n';
-		std::cout << '\t' << this->m_vbos[0] << '\n';
-		std::cout << '\t' << this->m_vbos[1] << '\n';
-		std::cout << '\t' << "Num vertices: " << this->m_mesh.vertices.size() << '\n';
-		std::cout << '\t' << "Num indices: " << this->m_mesh.indices.size() << '\n';
+		size_t mesh_bytes = m_mesh ? m_mesh->vertices.capacity() * sizeof(Vertex) + m_mesh->indices.capacity() * sizeof(GLushort) : 0;
+		return mesh_bytes + (bvh ? bvh->memory_bytes() : 0);
 	}
 
+	size_t gpu_bytes() const { return m_buffers ? m_buffers->bytes : 0; }
+
+	/**
+	 * @brief Number of models drawing the same GPU buffers, including this one
+	 *
+	 */
+	long share_count() const { return m_buffers.use_count(); }
+
+	/**
+	 * @brief Releases this model's reference to its buffers, deleting them if no other model shares them
+	 *
+	 */
+	void cleanup() { m_buffers.reset(); }
+
 	/**
-	 * @brief Destroy the Model object if it should be destroyed
+	 * @brief Prints simple info, like memory address, vao id, vbos id, num vertices, and num indices
 	 *
 	 */
-	~Model()
+	void print_debug_info()
 	{
-		if (should_be_destroyed)
+		std::cout << "Model " << this << " info:\n";
+		if (m_buffers)
 		{
-			cleanup();
+			std::cout << '\t' << m_buffers->vao << '\n';
+			std::cout << '\t' << m_buffers->vbos[0] << '\n';
+			std::cout << '\t' << m_buffers->vbos[1] << '\n';
 		}
+		std::cout << '\t' << "Num vertices: " << m_vertex_count << '\n';
+		std::cout << '\t' << "Num indices: " << m_index_count << '\n';
 	}
-};
\ No newline at end of file
+};
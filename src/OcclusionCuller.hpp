@@ -0,0 +1,411 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "JobSystem.hpp"
+#include "Math.hpp"
+#include "Vertex.hpp"
+
+/**
+ * @brief Software occlusion culling on the CPU.
+ *
+ * Each frame the designated occluder meshes are rasterized into a small depth buffer, a
+ * hierarchical max-depth pyramid is built over it, and bounding boxes are tested against the
+ * pyramid level where they cover only a couple of texels, refining into finer levels only where
+ * that is undecided. Triangle setup is spread over the job
+ * system by triangle and rasterization by horizontal band, and the inner loop shades four pixels
+ * per step with SSE when available.
+ *
+ * Depth is stored as window depth in [0, 1], larger is farther. Anything crossing the near plane
+ * is treated as visible, and occluder triangles crossing it are skipped, so errors only ever keep
+ * objects that could have been culled.
+ *
+ */
+class OcclusionCuller
+{
+public:
+    struct Stats
+    {
+        size_t occluder_triangles = 0;
+        size_t tested = 0;
+        size_t frustum_culled = 0;
+        size_t occluded = 0;
+        double raster_ms = 0.0;
+    };
+
+    static constexpr int band_height = 16;
+
+private:
+    struct Occluder
+    {
+        math::Mat4 world;
+        const Vertex *vertices;
+        size_t vertex_count;
+        const GLushort *indices;
+        size_t index_count;
+    };
+
+    // A triangle after projection, ready for edge function rasterization
+    struct ScreenTriangle
+    {
+        float edge_a[3], edge_b[3], edge_c[3]; // E_i(x, y) = a * x + b * y + c, inside when all >= 0
+        float z0, dzdx, dzdy;                  // depth plane, relative to the origin
+        int min_x, max_x, min_y, max_y;
+        bool valid;
+    };
+
+    int m_width;
+    int m_height;
+    std::vector<float> m_depth;
+    // Farthest and nearest depth per texel, level 0 is read from m_depth and its slot left unused
+    std::vector<float> m_pyramid;
+    std::vector<float> m_min_pyramid;
+    std::vector<size_t> m_level_offset;
+    std::vector<int> m_level_width;
+    std::vector<int> m_level_height;
+
+    math::Mat4 m_view_projection = math::Mat4::identity();
+    std::vector<Occluder> m_occluders;
+    std::vector<size_t> m_triangle_offsets;
+    std::vector<ScreenTriangle> m_triangles;
+    Stats m_stats;
+
+    const float *level_data(const std::vector<float> &pyramid, int level) const
+    {
+        return level == 0 ? m_depth.data() : pyramid.data() + m_level_offset[level];
+    }
+
+    void setup_triangle(const Occluder &occluder, size_t triangle, ScreenTriangle &out) const
+    {
+        out.valid = false;
+        math::Mat4 mvp = m_view_projection * occluder.world;
+
+        float sx[3], sy[3], sz[3];
+        for (int k = 0; k < 3; k++)
+        {
+            GLushort index = occluder.indices[3 * triangle + k];
+            if (index >= occluder.vertex_count)
+                return;
+            const auto &p = occluder.vertices[index].position;
+            math::Vec4 clip = mvp * math::Vec4{p[0], p[1], p[2], 1.0f};
+            if (clip.w <= 1e-5f)
+                return; // crosses the near plane, dropping it only makes culling less aggressive
+            float inv_w = 1.0f / clip.w;
+            sx[k] = (clip.x * inv_w * 0.5f + 0.5f) * m_width;
+            sy[k] = (clip.y * inv_w * 0.5f + 0.5f) * m_height;
+            sz[k] = clip.z * inv_w * 0.5f + 0.5f;
+        }
+
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if (std::fabs(area) < 1e-8f)
+            return;
+        if (area < 0.0f)
+        {
+            // Both windings are rasterized, normalise to counter-clockwise
+            std::swap(sx[1], sx[2]);
+            std::swap(sy[1], sy[2]);
+            std::swap(sz[1], sz[2]);
+            area = -area;
+        }
+
+        out.min_x = std::max(0, static_cast<int>(std::floor(std::min({sx[0], sx[1], sx[2]}))));
+        out.max_x = std::min(m_width - 1, static_cast<int>(std::ceil(std::max({sx[0], sx[1], sx[2]}))));
+        out.min_y = std::max(0, static_cast<int>(std::floor(std::min({sy[0], sy[1], sy[2]}))));
+        out.max_y = std::min(m_height - 1, static_cast<int>(std::ceil(std::max({sy[0], sy[1], sy[2]}))));
+        if (out.min_x > out.max_x || out.min_y > out.max_y)
+            return;
+
+        for (int k = 0; k < 3; k++)
+        {
+            int a = (k + 1) % 3, b = (k + 2) % 3;
+            out.edge_a[k] = sy[a] - sy[b];
+            out.edge_b[k] = sx[b] - sx[a];
+            out.edge_c[k] = sx[a] * sy[b] - sx[b] * sy[a];
+        }
+
+        float inv_area = 1.0f / area;
+        out.dzdx = ((sz[1] - sz[0]) * (sy[2] - sy[0]) - (sz[2] - sz[0]) * (sy[1] - sy[0])) * inv_area;
+        out.dzdy = ((sz[2] - sz[0]) * (sx[1] - sx[0]) - (sz[1] - sz[0]) * (sx[2] - sx[0])) * inv_area;
+        out.z0 = sz[0] - out.dzdx * sx[0] - out.dzdy * sy[0];
+        out.valid = true;
+    }
+
+    void rasterize_band(int band_min_y, int band_max_y)
+    {
+        for (const ScreenTriangle &tri : m_triangles)
+        {
+            if (!tri.valid || tri.max_y < band_min_y || tri.min_y > band_max_y)
+                continue;
+
+            int y0 = std::max(tri.min_y, band_min_y);
+            int y1 = std::min(tri.max_y, band_max_y);
+            for (int y = y0; y <= y1; y++)
+            {
+                float py = y + 0.5f;
+                float *row = m_depth.data() + static_cast<size_t>(y) * m_width;
+                int x = tri.min_x;
+#if MATH_SSE
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                for (; x + 3 <= tri.max_x; x += 4)
+                {
+                    __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+                    __m128 inside = _mm_set1_ps(0.0f);
+                    inside = _mm_cmpeq_ps(inside, inside); // all ones
+                    for (int k = 0; k < 3; k++)
+                    {
+                        __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edge_a[k]), px),
+                                              _mm_set1_ps(tri.edge_b[k] * py + tri.edge_c[k]));
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+                    }
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+                    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.dzdx), px), _mm_set1_ps(tri.z0 + tri.dzdy * py));
+                    __m128 old_depth = _mm_loadu_ps(row + x);
+                    __m128 nearer = _mm_min_ps(old_depth, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old_depth)));
+                }
+#endif
+                for (; x <= tri.max_x; x++)
+                {
+                    float px = x + 0.5f;
+                    bool inside = true;
+                    for (int k = 0; k < 3; k++)
+                        inside = inside && tri.edge_a[k] * px + tri.edge_b[k] * py + tri.edge_c[k] >= 0.0f;
+                    if (!inside)
+                        continue;
+                    float z = tri.dzdx * px + tri.z0 + tri.dzdy * py;
+                    row[x] = std::min(row[x], z);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Whether a box with nearest depth min_z can show through texel (x, y) of a level
+     *
+     * Behind the texel's farthest depth means hidden, in front of its nearest depth means visible,
+     * anything in between is refined into the children covered by the rectangle.
+     */
+    bool texel_visible(int level, int x, int y, const int rect[4], float min_z) const
+    {
+        int w = m_level_width[level];
+        size_t index = static_cast<size_t>(y) * w + x;
+        if (min_z > level_data(m_pyramid, level)[index])
+            return false;
+        if (level == 0 || min_z < level_data(m_min_pyramid, level)[index])
+            return true;
+
+        int child = level - 1;
+        int cw = m_level_width[child], ch = m_level_height[child];
+        int cx0 = std::max(2 * x, std::min(rect[0] >> child, cw - 1));
+        int cy0 = std::max(2 * y, std::min(rect[1] >> child, ch - 1));
+        int cx1 = std::min(x == w - 1 ? cw - 1 : 2 * x + 1, std::min(rect[2] >> child, cw - 1));
+        int cy1 = std::min(y == m_level_height[level] - 1 ? ch - 1 : 2 * y + 1, std::min(rect[3] >> child, ch - 1));
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++)
+            {
+                if (texel_visible(child, cx, cy, rect, min_z))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void build_pyramid()
+    {
+        for (size_t level = 1; level < m_level_width.size(); level++)
+        {
+            const float *src_max = level_data(m_pyramid, static_cast<int>(level) - 1);
+            const float *src_min = level_data(m_min_pyramid, static_cast<int>(level) - 1);
+            float *dst_max = m_pyramid.data() + m_level_offset[level];
+            float *dst_min = m_min_pyramid.data() + m_level_offset[level];
+            int src_w = m_level_width[level - 1], src_h = m_level_height[level - 1];
+            int w = m_level_width[level], h = m_level_height[level];
+
+            for (int y = 0; y < h; y++)
+            {
+                for (int x = 0; x < w; x++)
+                {
+                    float hi = 0.0f, lo = 1.0f;
+                    // Odd sizes fold the last row/column into the last texel
+                    int sx1 = (x == w - 1) ? src_w - 1 : 2 * x + 1;
+                    int sy1 = (y == h - 1) ? src_h - 1 : 2 * y + 1;
+                    for (int sy = 2 * y; sy <= sy1; sy++)
+                    {
+                        for (int sx = 2 * x; sx <= sx1; sx++)
+                        {
+                            hi = std::max(hi, src_max[sy * src_w + sx]);
+                            lo = std::min(lo, src_min[sy * src_w + sx]);
+                        }
+                    }
+                    dst_max[y * w + x] = hi;
+                    dst_min[y * w + x] = lo;
+                }
+            }
+        }
+    }
+
+public:
+    OcclusionCuller(int width = 256, int height = 160) : m_width(width), m_height(height)
+    {
+        m_depth.assign(static_cast<size_t>(width) * height, 1.0f);
+
+        size_t offset = 0;
+        int w = width, h = height;
+        for (;;)
+        {
+            m_level_offset.push_back(offset);
+            m_level_width.push_back(w);
+            m_level_height.push_back(h);
+            offset += static_cast<size_t>(w) * h;
+            if (w == 1 && h == 1)
+                break;
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        m_pyramid.assign(offset, 1.0f);
+        m_min_pyramid.assign(offset, 1.0f);
+    }
+
+    /**
+     * @brief Starts a frame: clears the depth buffer and forgets last frame's occluders
+     *
+     */
+    void begin_frame(const math::Mat4 &view_projection)
+    {
+        m_view_projection = view_projection;
+        m_occluders.clear();
+        m_stats = Stats{};
+    }
+
+    /**
+     * @brief Queues a mesh to be rasterized as an occluder, the data must stay alive until finish()
+     *
+     */
+    void add_occluder(const math::Mat4 &world, const Vertex *vertices, size_t vertex_count, const GLushort *indices,
+                      size_t index_count)
+    {
+        m_occluders.push_back({world, vertices, vertex_count, indices, index_count});
+    }
+
+    /**
+     * @brief Rasterizes every queued occluder and builds the depth pyramid
+     *
+     */
+    void finish(JobSystem &jobs = JobSystem::shared())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        m_triangle_offsets.clear();
+        size_t total = 0;
+        for (const auto &occluder : m_occluders)
+        {
+            m_triangle_offsets.push_back(total);
+            total += occluder.index_count / 3;
+        }
+        m_triangles.resize(total);
+        m_stats.occluder_triangles = total;
+
+        for (size_t o = 0; o < m_occluders.size(); o++)
+        {
+            const Occluder &occluder = m_occluders[o];
+            size_t base = m_triangle_offsets[o];
+            jobs.parallel_for(0, occluder.index_count / 3, 1024, [&](size_t b, size_t e) {
+                for (size_t t = b; t < e; t++)
+                    setup_triangle(occluder, t, m_triangles[base + t]);
+            });
+        }
+
+        std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+        int bands = (m_height + band_height - 1) / band_height;
+        jobs.parallel_for(0, bands, 1, [&](size_t b, size_t e) {
+            for (size_t band = b; band < e; band++)
+            {
+                int y0 = static_cast<int>(band) * band_height;
+                rasterize_band(y0, std::min(m_height - 1, y0 + band_height - 1));
+            }
+        });
+
+        build_pyramid();
+
+        m_stats.raster_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Tests a world space box against the frustum and the occluders rasterized this frame
+     *
+     * @return false if the box is certainly outside the view or hidden
+     */
+    bool is_visible(const math::AABB &box)
+    {
+        m_stats.tested++;
+
+        float min_x = INFINITY, min_y = INFINITY, min_z = INFINITY;
+        float max_x = -INFINITY, max_y = -INFINITY;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            math::Vec4 p = {corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                            corner & 4 ? box.max.z : box.min.z, 1.0f};
+            math::Vec4 clip = m_view_projection * p;
+            if (clip.w <= 1e-5f)
+                return true; // crosses the near plane
+            float inv_w = 1.0f / clip.w;
+            float x = clip.x * inv_w, y = clip.y * inv_w, z = clip.z * inv_w * 0.5f + 0.5f;
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+            min_z = std::min(min_z, z);
+        }
+
+        if (max_x < -1.0f || min_x > 1.0f || max_y < -1.0f || min_y > 1.0f || min_z > 1.0f)
+        {
+            m_stats.frustum_culled++;
+            return false;
+        }
+
+        int x0 = std::max(0, static_cast<int>((min_x * 0.5f + 0.5f) * m_width));
+        int x1 = std::min(m_width - 1, static_cast<int>((max_x * 0.5f + 0.5f) * m_width));
+        int y0 = std::max(0, static_cast<int>((min_y * 0.5f + 0.5f) * m_height));
+        int y1 = std::min(m_height - 1, static_cast<int>((max_y * 0.5f + 0.5f) * m_height));
+
+        // Coarsest level where the rectangle spans at most two texels a side
+        int level = 0;
+        while (level + 1 < static_cast<int>(m_level_width.size()) && ((x1 >> level) - (x0 >> level) > 1 ||
+                                                                      (y1 >> level) - (y0 >> level) > 1))
+            level++;
+
+        int rect[4] = {x0, y0, x1, y1};
+        int w = m_level_width[level], h = m_level_height[level];
+        for (int y = std::min(y0 >> level, h - 1); y <= std::min(y1 >> level, h - 1); y++)
+        {
+            for (int x = std::min(x0 >> level, w - 1); x <= std::min(x1 >> level, w - 1); x++)
+            {
+                if (texel_visible(level, x, y, rect, min_z))
+                    return true;
+            }
+        }
+
+        m_stats.occluded++;
+        return false;
+    }
+
+    bool has_occluders() const { return !m_occluders.empty(); }
+    const Stats &stats() const { return m_stats; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    /**
+     * @brief The level 0 depth buffer, row 0 at the bottom, for debugging views
+     *
+     */
+    const float *depth() const { return m_depth.data(); }
+};
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "EdgeList.hpp"
+#include "GeometryPages.hpp"
+#include "Math.hpp"
+
+/**
+ * @brief Streams the pages of a paged geometry file in and out around the camera.
+ *
+ * Pages within load_radius of the camera, or of where the camera will be prefetch_seconds from
+ * now, are read from disk by a loader thread and uploaded on the main thread a few per frame.
+ * Page data read from disk stays cached on the CPU and uploaded pages stay on the GPU until their
+ * budget is needed, then the least recently wanted pages are evicted first. Opened for GL_LINES,
+ * the loader replaces each page's triangles with their deduplicated edge list.
+ *
+ */
+class PagedGeometry
+{
+public:
+    struct Stats
+    {
+        size_t pages = 0;
+        size_t loading = 0;
+        size_t cpu_resident = 0;
+        size_t gpu_resident = 0;
+        size_t wanted = 0;
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+        uint64_t loads = 0;
+        uint64_t uploads = 0;
+        uint64_t cpu_evictions = 0;
+        uint64_t gpu_evictions = 0;
+        size_t over_budget = 0; // pages wanted this frame that didn't fit in a budget
+        size_t failed = 0;      // pages that couldn't be read, never requested again
+    };
+
+    size_t cpu_budget = size_t(256) << 20;
+    size_t gpu_budget = size_t(256) << 20;
+    float load_radius = 50.0f;
+    float prefetch_seconds = 1.0f;
+    int uploads_per_frame = 4;
+    size_t max_in_flight = 8;
+
+private:
+    struct Page
+    {
+        PageEntry entry;
+        std::vector<GLfloat> vertices; // CPU copy, empty when not cached
+        std::vector<GLushort> indices; // edges when opened for GL_LINES
+        GLsizei index_count = 0;       // as loaded, drawn while on the GPU
+        size_t bytes = 0;              // vertices and indices as loaded, counted against both budgets
+        bool cpu = false;
+        bool loading = false;
+        bool failed = false; // the read failed, retrying a corrupt or truncated page would never end
+        GLuint vao = 0, vbo = 0, ebo = 0; // vao is 0 when not on the GPU
+        uint64_t last_wanted = 0;
+        float priority = 0.0f;
+    };
+
+    struct LoadResult
+    {
+        size_t page;
+        std::vector<GLfloat> vertices;
+        std::vector<GLushort> indices;
+        bool ok;
+    };
+
+    std::string m_path;
+    bool m_edges = false;
+    PageFileHeader m_header{};
+    std::vector<Page> m_pages;
+    std::vector<size_t> m_candidates;
+    uint64_t m_frame = 0;
+    math::Vec3 m_last_camera{};
+    math::Vec3 m_velocity{};
+    bool m_has_camera = false;
+    size_t m_in_flight_bytes = 0;
+    size_t m_deferred_uploads = 0; // loaded and wanted, but over this frame's upload limit
+    Stats m_stats;
+
+    // Disk reads block, so they get their own thread instead of occupying a JobSystem worker
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<size_t> m_requests;
+    std::vector<LoadResult> m_results;
+    bool m_stop = false;
+
+    void loader_loop()
+    {
+        std::ifstream file(m_path, std::ios::binary);
+        for (;;)
+        {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+                if (m_stop)
+                    return;
+                index = m_requests.front();
+                m_requests.pop_front();
+            }
+
+            LoadResult result{index, {}, {}, false};
+            result.ok = read_page(file, m_pages[index].entry, result.vertices, result.indices);
+            if (result.ok && m_edges)
+                result.indices = build_edge_list(result.indices);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(std::move(result));
+        }
+    }
+
+    static float distance_to(const math::AABB &box, const math::Vec3 &p)
+    {
+        math::Vec3 nearest = math::min(math::max(p, box.min), box.max);
+        return math::length(nearest - p);
+    }
+
+    size_t cpu_used() const { return m_stats.cpu_bytes + m_in_flight_bytes; }
+
+    /**
+     * @brief The least recently wanted page matching evictable, nullptr if there is none
+     *
+     */
+    template <typename Fn>
+    Page *least_recently_wanted(Fn &&evictable)
+    {
+        Page *oldest = nullptr;
+        for (Page &page : m_pages)
+        {
+            if (evictable(page) && (!oldest || page.last_wanted < oldest->last_wanted))
+                oldest = &page;
+        }
+        return oldest;
+    }
+
+    void drop_cpu(Page &page)
+    {
+        m_stats.cpu_bytes -= page.bytes;
+        page.vertices = {};
+        page.indices = {};
+        page.cpu = false;
+    }
+
+    void drop_gpu(Page &page)
+    {
+        glDeleteVertexArrays(1, &page.vao);
+        glDeleteBuffers(1, &page.vbo);
+        glDeleteBuffers(1, &page.ebo);
+        page.vao = page.vbo = page.ebo = 0;
+        m_stats.gpu_bytes -= page.bytes;
+    }
+
+    /**
+     * @brief Frees CPU cache until bytes more fit, never touching pages wanted this frame that aren't on the GPU
+     *
+     */
+    bool reserve_cpu(size_t bytes)
+    {
+        while (cpu_used() + bytes > cpu_budget)
+        {
+            Page *victim = least_recently_wanted(
+                [this](const Page &p) { return p.cpu && (p.last_wanted < m_frame || p.vao != 0); });
+            if (!victim)
+                return false;
+            drop_cpu(*victim);
+            m_stats.cpu_evictions++;
+        }
+        return true;
+    }
+
+    bool reserve_gpu(size_t bytes)
+    {
+        while (m_stats.gpu_bytes + bytes > gpu_budget)
+        {
+            Page *victim = least_recently_wanted([this](const Page &p) { return p.vao != 0 && p.last_wanted < m_frame; });
+            if (!victim)
+                return false;
+            drop_gpu(*victim);
+            m_stats.gpu_evictions++;
+        }
+        return true;
+    }
+
+    void upload(Page &page)
+    {
+        glGenVertexArrays(1, &page.vao);
+        glGenBuffers(1, &page.vbo);
+        glGenBuffers(1, &page.ebo);
+
+        glBindVertexArray(page.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, page.vbo);
+        glBufferData(GL_ARRAY_BUFFER, page.entry.vertex_bytes(), page.vertices.data(), GL_STATIC_DRAW);
+        // Same attribute layout as Model: position then color
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, page.indices.size() * sizeof(GLushort), page.indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+
+        m_stats.gpu_bytes += page.bytes;
+        m_stats.uploads++;
+    }
+
+public:
+    PagedGeometry() = default;
+
+    ~PagedGeometry() { close(); }
+
+    PagedGeometry(const PagedGeometry &) = delete;
+    PagedGeometry &operator=(const PagedGeometry &) = delete;
+
+    /**
+     * @brief Reads the page directory and starts the loader, no geometry is loaded yet
+     *
+     * @param line_edges Load each page as the edge list to draw with GL_LINES instead of its triangles
+     */
+    bool open(const std::string &path, bool line_edges = false)
+    {
+        close();
+
+        std::vector<PageEntry> entries;
+        uint64_t file_size = 0;
+        if (!read_page_directory(path, m_header, entries, &file_size))
+            return false;
+
+        m_path = path;
+        m_edges = line_edges;
+        m_pages.resize(entries.size());
+        m_stats = Stats{};
+        m_stats.pages = m_pages.size();
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            m_pages[i].entry = entries[i];
+            // Never requested, its counts would size the budget reservations and the read
+            if (!page_entry_valid(entries[i], file_size))
+            {
+                m_pages[i].failed = true;
+                m_stats.failed++;
+            }
+        }
+
+        m_stop = false;
+        m_loader = std::thread([this] { loader_loop(); });
+        return true;
+    }
+
+    void close()
+    {
+        if (m_loader.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            m_loader.join();
+        }
+        for (Page &page : m_pages)
+        {
+            if (page.vao)
+                drop_gpu(page);
+        }
+        m_pages.clear();
+        m_requests.clear();
+        m_results.clear();
+        m_in_flight_bytes = 0;
+        m_has_camera = false;
+    }
+
+    /**
+     * @brief Picks up finished loads, requests and uploads pages near the camera and evicts within budget
+     *
+     * @return true if the set of pages on the GPU changed
+     */
+    bool update(const math::Vec3 &camera, float delta_time)
+    {
+        if (m_pages.empty())
+            return false;
+
+        m_frame++;
+        bool changed = false;
+
+        // Velocity from camera motion, smoothed so a single jerky frame doesn't redirect prefetching
+        if (m_has_camera && delta_time > 0.0f)
+            m_velocity = m_velocity * 0.8f + (camera - m_last_camera) * (0.2f / delta_time);
+        m_last_camera = camera;
+        m_has_camera = true;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (LoadResult &result : m_results)
+            {
+                Page &page = m_pages[result.page];
+                page.loading = false;
+                m_in_flight_bytes -= page.entry.bytes();
+                if (!result.ok)
+                {
+                    page.failed = true;
+                    m_stats.failed++;
+                    continue;
+                }
+                page.vertices = std::move(result.vertices);
+                page.indices = std::move(result.indices);
+                page.index_count = static_cast<GLsizei>(page.indices.size());
+                page.bytes = page.entry.vertex_bytes() + page.indices.size() * sizeof(GLushort);
+                page.cpu = true;
+                m_stats.cpu_bytes += page.bytes;
+                m_stats.loads++;
+            }
+            m_results.clear();
+        }
+
+        // Pages around the camera come first by distance, then pages around the predicted position
+        math::Vec3 predicted = camera + m_velocity * prefetch_seconds;
+        m_candidates.clear();
+        m_stats.wanted = 0;
+        m_stats.over_budget = 0;
+        for (size_t i = 0; i < m_pages.size(); i++)
+        {
+            Page &page = m_pages[i];
+            float near_distance = distance_to(page.entry.bounds, camera);
+            float ahead = distance_to(page.entry.bounds, predicted);
+            if (near_distance <= load_radius)
+            {
+                page.priority = near_distance;
+                m_stats.wanted++;
+            }
+            else if (ahead <= load_radius)
+                page.priority = load_radius + ahead;
+            else
+                continue;
+            page.last_wanted = m_frame;
+            m_candidates.push_back(i);
+        }
+        std::sort(m_candidates.begin(), m_candidates.end(),
+                  [this](size_t a, size_t b) { return m_pages[a].priority < m_pages[b].priority; });
+
+        int uploads = 0;
+        m_deferred_uploads = 0;
+        size_t in_flight = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            in_flight = m_requests.size();
+        }
+        for (size_t index : m_candidates)
+        {
+            Page &page = m_pages[index];
+            size_t bytes = page.entry.bytes(); // the file's size until loaded, edge lists differ a little
+
+            if (page.vao == 0 && page.cpu && uploads >= uploads_per_frame)
+                m_deferred_uploads++;
+            else if (page.vao == 0 && page.cpu)
+            {
+                if (reserve_gpu(page.bytes))
+                {
+                    upload(page);
+                    uploads++;
+                    changed = true;
+                }
+                else
+                    m_stats.over_budget++;
+            }
+            else if (page.vao == 0 && !page.cpu && !page.loading && !page.failed && in_flight < max_in_flight)
+            {
+                if (reserve_cpu(bytes))
+                {
+                    page.loading = true;
+                    m_in_flight_bytes += bytes;
+                    in_flight++;
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_requests.push_back(index);
+                    }
+                    m_wake.notify_one();
+                }
+                else
+                    m_stats.over_budget++;
+            }
+        }
+
+        // A smaller budget set from the menu takes effect right away
+        size_t gpu_before = m_stats.gpu_evictions;
+        reserve_gpu(0);
+        reserve_cpu(0);
+        changed = changed || m_stats.gpu_evictions != gpu_before;
+
+        m_stats.loading = 0;
+        m_stats.cpu_resident = 0;
+        m_stats.gpu_resident = 0;
+        for (const Page &page : m_pages)
+        {
+            m_stats.loading += page.loading;
+            m_stats.cpu_resident += page.cpu;
+            m_stats.gpu_resident += page.vao != 0;
+        }
+        return changed;
+    }
+
+    /**
+     * @brief Whether pages are still on their way, so the caller keeps updating while idle
+     *
+     */
+    bool busy() const { return m_stats.loading > 0 || m_deferred_uploads > 0; }
+
+    /**
+     * @brief Calls fn(bounds, vao, index_count) for every page on the GPU
+     *
+     */
+    template <typename Fn>
+    void for_each_resident(Fn &&fn) const
+    {
+        for (const Page &page : m_pages)
+        {
+            if (page.vao)
+                fn(page.entry.bounds, page.vao, page.index_count);
+        }
+    }
+
+    const Stats &stats() const { return m_stats; }
+    const math::AABB &bounds() const { return m_header.bounds; }
+    bool is_open() const { return !m_pages.empty(); }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "PagedGeometry.hpp"
+
+namespace GUI {
+
+    class PagingWidget : public Widget {
+    public:
+        PagingWidget(PagedGeometry& paged) : m_Paged(paged) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Geometry paging"))
+                return;
+
+            const PagedGeometry::Stats& stats = m_Paged.stats();
+            const double mb = 1.0 / (1024.0 * 1024.0);
+            ImGui::Text("Pages: %zu, wanted %zu, loading %zu", stats.pages, stats.wanted, stats.loading);
+            ImGui::Text("CPU: %zu pages, %.1f / %.1f MB", stats.cpu_resident, stats.cpu_bytes * mb, m_Paged.cpu_budget * mb);
+            ImGui::Text("GPU: %zu pages, %.1f / %.1f MB", stats.gpu_resident, stats.gpu_bytes * mb, m_Paged.gpu_budget * mb);
+            ImGui::Text("Loads %llu, uploads %llu", static_cast<unsigned long long>(stats.loads),
+                        static_cast<unsigned long long>(stats.uploads));
+            ImGui::Text("Evictions: CPU %llu, GPU %llu", static_cast<unsigned long long>(stats.cpu_evictions),
+                        static_cast<unsigned long long>(stats.gpu_evictions));
+            if (stats.over_budget > 0)
+                ImGui::Text("%zu wanted pages don't fit in the budget", stats.over_budget);
+            if (stats.failed > 0)
+                ImGui::Text("%zu pages couldn't be read", stats.failed);
+
+            int cpu_mb = static_cast<int>(m_Paged.cpu_budget >> 20);
+            int gpu_mb = static_cast<int>(m_Paged.gpu_budget >> 20);
+            if (ImGui::SliderInt("CPU budget (MB)", &cpu_mb, 16, 4096))
+                m_Paged.cpu_budget = static_cast<size_t>(cpu_mb) << 20;
+            if (ImGui::SliderInt("GPU budget (MB)", &gpu_mb, 16, 4096))
+                m_Paged.gpu_budget = static_cast<size_t>(gpu_mb) << 20;
+            ImGui::SliderFloat("Load radius", &m_Paged.load_radius, 1.0f, 1000.0f);
+            ImGui::SliderFloat("Prefetch (s)", &m_Paged.prefetch_seconds, 0.0f, 5.0f);
+        }
+
+    private:
+        PagedGeometry& m_Paged;
+    };
+
+}
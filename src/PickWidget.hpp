@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "Renderer.hpp"
+#include <optional>
+
+namespace GUI {
+
+    class PickWidget : public Widget {
+    public:
+        PickWidget(const Renderer& renderer) : m_Renderer(renderer) {}
+
+        void SetResult(const std::optional<PickResult>& result, double query_us) {
+            m_Result = result;
+            m_QueryUs = query_us;
+            m_Picked = true;
+        }
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Picking"))
+                return;
+
+            if (m_Renderer.models.empty()) {
+                ImGui::TextUnformatted("No models to pick, point clouds (GL_POINTS) and paged geometry can't be picked");
+                return;
+            }
+
+            if (!m_Picked) {
+                ImGui::TextUnformatted("Leave camera mode (Esc) and click the model");
+                return;
+            }
+
+            ImGui::Text("Query: %.2f us", m_QueryUs);
+            if (!m_Result) {
+                ImGui::TextUnformatted("No hit");
+                return;
+            }
+
+            const PickResult& pick = *m_Result;
+            ImGui::Text("Model %zu, triangle %u", pick.model_index, pick.hit.triangle);
+            ImGui::Text("Distance: %.3f", pick.distance);
+            ImGui::Text("Point: %.3f %.3f %.3f", pick.world_point.x, pick.world_point.y, pick.world_point.z);
+            ImGui::Text("Barycentric: %.3f %.3f", pick.hit.u, pick.hit.v);
+            if (pick.model->bvh) {
+                const BVH& bvh = *pick.model->bvh;
+                ImGui::Text("BVH: %zu nodes, depth %u, built in %.1f ms", bvh.node_count(), bvh.depth(), bvh.build_ms());
+            }
+        }
+
+    private:
+        const Renderer& m_Renderer;
+        std::optional<PickResult> m_Result;
+        double m_QueryUs = 0.0;
+        bool m_Picked = false;
+    };
+
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "JobSystem.hpp"
+#include "Math.hpp"
+
+/**
+ * @brief Octree level of detail for drawing large point sets with GL_POINTS.
+ *
+ * Every node keeps a grid-subsampled selection of the points in its cube, at most one per cell
+ * of a grid_resolution^3 grid, and passes the rest down to its children, so drawing a node and
+ * then its children only ever adds detail. The points are reordered so each node's own points
+ * are one contiguous range of a single vertex buffer.
+ *
+ * Each frame select() walks the tree from the root, largest projected node first, and stops at
+ * the point budget or when nodes get smaller than min_node_pixels on screen.
+ *
+ */
+class PointCloud
+{
+public:
+    struct Node
+    {
+        math::AABB bounds; // the node's cube, not the tight bounds of its points
+        uint32_t first;    // range of this node's own points in the vertex buffer
+        uint32_t count;
+        int32_t children[8]; // -1 where there is no child
+    };
+
+    struct Stats
+    {
+        size_t nodes_selected = 0;
+        size_t points_drawn = 0;
+        size_t draw_ranges = 0;
+        double select_us = 0.0;
+    };
+
+    static constexpr uint32_t grid_resolution = 32;    // cells per axis a node samples its points with
+    static constexpr uint32_t leaf_capacity = 8192;     // points a node holds before it is split
+    static constexpr uint32_t max_depth = 20;           // coincident points end up in a leaf anyway
+    static constexpr uint32_t parallel_threshold = 65536; // points below which a subtree is built inline
+
+    size_t point_budget = 2000000;
+    float min_node_pixels = 50.0f;
+
+private:
+    struct BuildNode
+    {
+        math::AABB cube;
+        uint32_t first = 0, count = 0;
+        std::unique_ptr<BuildNode> children[8];
+    };
+
+    std::vector<Node> m_nodes;
+    size_t m_point_count = 0;
+    double m_build_ms = 0.0;
+
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+
+    // Per frame scratch, reused
+    std::vector<std::pair<float, uint32_t>> m_queue;
+    std::vector<GLint> m_firsts;
+    std::vector<GLsizei> m_counts;
+    Stats m_stats;
+
+    static uint32_t cell_of(float v, float min, float inv_size, uint32_t resolution)
+    {
+        int cell = static_cast<int>((v - min) * inv_size * resolution);
+        return static_cast<uint32_t>(std::clamp(cell, 0, static_cast<int>(resolution) - 1));
+    }
+
+    static void build_node(BuildNode &node, const math::Vec3 *points, uint32_t *order, uint32_t begin, uint32_t end,
+                           uint32_t depth, JobSystem::TaskGroup &group)
+    {
+        node.first = begin;
+        if (end - begin <= leaf_capacity || depth >= max_depth)
+        {
+            node.count = end - begin;
+            return;
+        }
+
+        // One point per grid cell stays in this node, swapped to the front of the range
+        const math::Vec3 &min = node.cube.min;
+        float inv_size = 1.0f / std::max(node.cube.max.x - node.cube.min.x, 1e-30f);
+        std::vector<uint8_t> taken(grid_resolution * grid_resolution * grid_resolution, 0);
+        uint32_t selected = begin;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const math::Vec3 &p = points[order[i]];
+            uint32_t cell = (cell_of(p.z, min.z, inv_size, grid_resolution) * grid_resolution +
+                             cell_of(p.y, min.y, inv_size, grid_resolution)) * grid_resolution +
+                            cell_of(p.x, min.x, inv_size, grid_resolution);
+            if (!taken[cell])
+            {
+                taken[cell] = 1;
+                std::swap(order[i], order[selected++]);
+            }
+        }
+        node.count = selected - begin;
+
+        // The rest goes to the octants, split in place along x, then y, then z
+        math::Vec3 center = node.cube.center();
+        uint32_t bounds[9];
+        bounds[0] = selected;
+        bounds[8] = end;
+        auto split = [&](uint32_t b, uint32_t e, int axis) {
+            return static_cast<uint32_t>(
+                std::partition(order + b, order + e, [&](uint32_t i) { return points[i][axis] < center[axis]; }) - order);
+        };
+        bounds[4] = split(bounds[0], bounds[8], 0);
+        bounds[2] = split(bounds[0], bounds[4], 1);
+        bounds[6] = split(bounds[4], bounds[8], 1);
+        for (int k = 0; k < 8; k += 2)
+            bounds[k + 1] = split(bounds[k], bounds[k + 2], 2);
+
+        math::Vec3 half = node.cube.extent();
+        for (int octant = 0; octant < 8; octant++)
+        {
+            uint32_t b = bounds[octant], e = bounds[octant + 1];
+            if (b == e)
+                continue;
+
+            // Octant bits are x (4), y (2), z (1), matching the order of the splits
+            auto child = std::make_unique<BuildNode>();
+            math::Vec3 offset = {octant & 4 ? half.x : 0.0f, octant & 2 ? half.y : 0.0f, octant & 1 ? half.z : 0.0f};
+            child->cube = {min + offset, min + offset + half};
+            BuildNode &child_ref = *child;
+            node.children[octant] = std::move(child);
+
+            if (e - b >= parallel_threshold)
+                group.run([&child_ref, points, order, b, e, depth, &group] {
+                    build_node(child_ref, points, order, b, e, depth + 1, group);
+                });
+            else
+                build_node(child_ref, points, order, b, e, depth + 1, group);
+        }
+    }
+
+    /**
+     * @brief Whether a box is entirely outside one of the clip planes
+     *
+     */
+    static bool outside_frustum(const math::Mat4 &mvp, const math::AABB &box)
+    {
+        int outside[6] = {0, 0, 0, 0, 0, 0};
+        for (int corner = 0; corner < 8; corner++)
+        {
+            math::Vec4 c = mvp * math::Vec4{corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                                            corner & 4 ? box.max.z : box.min.z, 1.0f};
+            outside[0] += c.x < -c.w;
+            outside[1] += c.x > c.w;
+            outside[2] += c.y < -c.w;
+            outside[3] += c.y > c.w;
+            outside[4] += c.z < -c.w;
+            outside[5] += c.z > c.w;
+        }
+        for (int plane = 0; plane < 6; plane++)
+        {
+            if (outside[plane] == 8)
+                return true;
+        }
+        return false;
+    }
+
+public:
+    PointCloud() = default;
+
+    ~PointCloud()
+    {
+        glDeleteVertexArrays(1, &m_vao);
+        glDeleteBuffers(1, &m_vbo);
+    }
+
+    PointCloud(const PointCloud &) = delete;
+    PointCloud &operator=(const PointCloud &) = delete;
+
+    /**
+     * @brief Builds the octree and uploads the reordered points
+     *
+     */
+    void build(const std::vector<math::Vec3> &points, std::array<GLfloat, 3> color = {1.0f, 1.0f, 1.0f},
+               JobSystem &jobs = JobSystem::shared())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        m_point_count = points.size();
+        std::vector<uint32_t> order(points.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        // Octree cells are cubes around the points' bounds
+        math::AABB bounds = math::compute_bounds(points.data(), points.size());
+        math::Vec3 extent = bounds.max - bounds.min;
+        float size = std::max({extent.x, extent.y, extent.z, 1e-6f});
+        BuildNode root;
+        root.cube = {bounds.min, bounds.min + math::Vec3{size, size, size}};
+        {
+            JobSystem::TaskGroup group(jobs);
+            build_node(root, points.data(), order.data(), 0, static_cast<uint32_t>(points.size()), 0, group);
+            group.wait();
+        }
+
+        // Flatten breadth first, coarse nodes end up at the front
+        m_nodes.clear();
+        std::vector<const BuildNode *> queue = {&root};
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            const BuildNode &b = *queue[i];
+            Node node = {b.cube, b.first, b.count, {-1, -1, -1, -1, -1, -1, -1, -1}};
+            for (int k = 0; k < 8; k++)
+            {
+                if (b.children[k])
+                {
+                    node.children[k] = static_cast<int32_t>(queue.size());
+                    queue.push_back(b.children[k].get());
+                }
+            }
+            m_nodes.push_back(node);
+        }
+
+        std::vector<GLfloat> vertices(points.size() * 6);
+        jobs.parallel_for(0, points.size(), 65536, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+            {
+                const math::Vec3 &p = points[order[i]];
+                GLfloat *v = &vertices[i * 6];
+                v[0] = p.x;
+                v[1] = p.y;
+                v[2] = p.z;
+                v[3] = color[0];
+                v[4] = color[1];
+                v[5] = color[2];
+            }
+        });
+
+        if (!m_vao)
+        {
+            glGenVertexArrays(1, &m_vao);
+            glGenBuffers(1, &m_vbo);
+        }
+        glBindVertexArray(m_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void *)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+
+        m_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Picks the nodes to draw this frame
+     *
+     * @param mvp Model view projection matrix of the cloud
+     * @param camera Camera position in the cloud's model space
+     * @param pixels_per_radian Screen height over the vertical field of view, projection[1][1] * height / 2
+     */
+    void select(const math::Mat4 &mvp, const math::Vec3 &camera, float pixels_per_radian)
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_stats = Stats{};
+        m_firsts.clear();
+        m_counts.clear();
+        m_queue.clear();
+        if (m_nodes.empty())
+            return;
+
+        auto projected_size = [&](const Node &node) {
+            float radius = math::length(node.bounds.extent());
+            float distance = std::max(math::length(node.bounds.center() - camera) - radius, 1e-3f);
+            return radius / distance * pixels_per_radian;
+        };
+
+        auto by_size = [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) {
+            return a.first < b.first;
+        };
+        m_queue.push_back({projected_size(m_nodes[0]), 0});
+        while (!m_queue.empty())
+        {
+            std::pop_heap(m_queue.begin(), m_queue.end(), by_size);
+            uint32_t index = m_queue.back().second;
+            m_queue.pop_back();
+
+            const Node &node = m_nodes[index];
+            if (outside_frustum(mvp, node.bounds))
+                continue;
+            if (m_stats.points_drawn + node.count > point_budget)
+                break;
+
+            m_stats.nodes_selected++;
+            m_stats.points_drawn += node.count;
+            // Neighbouring ranges become one draw
+            if (!m_counts.empty() && static_cast<uint32_t>(m_firsts.back() + m_counts.back()) == node.first)
+                m_counts.back() += node.count;
+            else
+            {
+                m_firsts.push_back(static_cast<GLint>(node.first));
+                m_counts.push_back(static_cast<GLsizei>(node.count));
+            }
+
+            for (int32_t child : node.children)
+            {
+                if (child < 0)
+                    continue;
+                float size = projected_size(m_nodes[child]);
+                if (size >= min_node_pixels)
+                {
+                    m_queue.push_back({size, static_cast<uint32_t>(child)});
+                    std::push_heap(m_queue.begin(), m_queue.end(), by_size);
+                }
+            }
+        }
+
+        m_stats.draw_ranges = m_counts.size();
+        m_stats.select_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Draws the nodes chosen by the last select()
+     *
+     */
+    void draw() const
+    {
+        if (m_counts.empty())
+            return;
+        glBindVertexArray(m_vao);
+        glMultiDrawArrays(GL_POINTS, m_firsts.data(), m_counts.data(), static_cast<GLsizei>(m_counts.size()));
+        glBindVertexArray(0);
+    }
+
+    const Stats &stats() const { return m_stats; }
+    size_t node_count() const { return m_nodes.size(); }
+    size_t point_count() const { return m_point_count; }
+    double build_ms() const { return m_build_ms; }
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "PointCloud.hpp"
+
+namespace GUI {
+
+    class PointCloudWidget : public Widget {
+    public:
+        PointCloudWidget(PointCloud& cloud) : m_Cloud(cloud) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Point cloud"))
+                return;
+
+            const PointCloud::Stats& stats = m_Cloud.stats();
+            ImGui::Text("%zu points in %zu nodes, built in %.1f ms", m_Cloud.point_count(), m_Cloud.node_count(),
+                        m_Cloud.build_ms());
+            ImGui::Text("Drawn: %zu points, %zu nodes in %zu ranges", stats.points_drawn, stats.nodes_selected,
+                        stats.draw_ranges);
+            ImGui::Text("Selection: %.1f us", stats.select_us);
+
+            int budget_k = static_cast<int>(m_Cloud.point_budget / 1000);
+            if (ImGui::SliderInt("Point budget (k)", &budget_k, 10, 20000))
+                m_Cloud.point_budget = static_cast<size_t>(budget_k) * 1000;
+            ImGui::SliderFloat("Min node size (px)", &m_Cloud.min_node_pixels, 5.0f, 500.0f);
+        }
+
+    private:
+        PointCloud& m_Cloud;
+    };
+
+}
@@ -1,22 +1,38 @@
 #pragma once
 
+#include <iostream>
 #include <list>
 #include <string>
 #include <memory>
+#include <new>
+#include <optional>
+#include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
+#include "Broadphase.hpp"
+#include "DynamicMesh.hpp"
+#include "FrameArena.hpp"
+#include "Math.hpp"
 #include "Model.hpp"
+#include "OcclusionCuller.hpp"
+#include "PagedGeometry.hpp"
+#include "PointCloud.hpp"
 #include "Shader.hpp"
 
-// Include cglm for the mat4 typedef
-extern "C" {
-#include <cglm/cglm.h>
-}
+/**
+ * @brief The closest model hit by a picking ray
+ *
+ */
+struct PickResult
+{
+    const Model *model;
+    size_t model_index;
+    BVH::RayHit hit;
+    math::Vec3 world_point;
+    float distance; // from the ray origin, in world units
+};
 
 /**
  * @brief Keep track of models and render them
@@ -27,20 +43,99 @@ class Renderer
 public:
     std::list<std::unique_ptr<Model>> models;
     Shader shader;
-    glm::mat4 projection;
-    glm::mat4 view;
+    math::Mat4 projection;
+    math::Mat4 view;
     int mode;
     float distance;
+    bool animate = true; // spin the models around the y axis
+    float rotation = 0.0f;
+
+    // The scene is drawn into its own framebuffer so it can be presented again without redrawing
+    GLuint scene_fbo = 0;
+    GLuint scene_color = 0;
+    GLuint scene_depth = 0;
+    int width;
+    int height;
+
+    // World matrices and bounds of the models for this frame, in the frame arena so they are
+    // valid until its next reset and never touch the heap
+    FrameArena &frame_arena;
+    math::Mat4 *world_transforms = nullptr;
+    math::AABB *world_bounds = nullptr;
+    size_t world_count = 0;
+
+    // Models marked as occluders are rasterized on the CPU and hide whatever is behind them
+    OcclusionCuller culler;
+    bool occlusion_culling = true;
+    size_t drawn_models = 0;
+
+    // Streamed world geometry, drawn as is without the model spin
+    PagedGeometry *paged = nullptr;
+    size_t drawn_pages = 0;
+
+    // Level of detail point set for GL_POINTS mode, spun like the models
+    PointCloud *point_cloud = nullptr;
+
+    // Meshes whose vertices are rewritten every frame, drawn with their own transform
+    std::vector<DynamicMesh *> dynamic_meshes;
+
+    // World bounds of every model, kept in a broadphase for overlap and camera queries
+    Broadphase broadphase;
+    std::vector<Broadphase::Proxy> model_proxies;
+    bool camera_collision = false; // off by default, the bounds of spinning or enclosing models would trap the camera
+    float camera_radius = 0.25f;
+    size_t camera_contacts = 0;
+    bool pair_search_requested = false; // set by whoever shows the pairs, the camera only needs queries
 
     Renderer(const std::string &vertexPath,
              const std::string &fragmentPath,
              int screenWidth,
              int screenHeight,
              int mode,
-             float distance)
-        : shader(vertexPath, fragmentPath), projection(1.0f), view(1.0f), mode(mode), distance(distance)
+             float distance,
+             FrameArena &frame_arena)
+        : shader(vertexPath, fragmentPath), projection(math::Mat4::identity()), view(math::Mat4::identity()), mode(mode), distance(distance),
+          width(screenWidth), height(screenHeight), frame_arena(frame_arena)
+    {
+        projection = math::perspective(math::radians(45.0f), (GLfloat)screenWidth / screenHeight, 0.1f, 500.0f);
+
+        glGenFramebuffers(1, &scene_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, scene_fbo);
+
+        glGenRenderbuffers(1, &scene_color);
+        glBindRenderbuffer(GL_RENDERBUFFER, scene_color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scene_color);
+
+        glGenRenderbuffers(1, &scene_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, scene_depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, scene_depth);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "Scene framebuffer is incomplete\n";
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~Renderer()
+    {
+        glDeleteFramebuffers(1, &scene_fbo);
+        glDeleteRenderbuffers(1, &scene_color);
+        glDeleteRenderbuffers(1, &scene_depth);
+    }
+
+    /**
+     * @brief Advances animation, returns true if that changed the scene
+     *
+     */
+    bool update(float delta_time)
     {
-        projection = glm::perspective(glm::radians(45.0f), (GLfloat)screenWidth / screenHeight, 0.1f, 500.0f);
+        if (!animate)
+            return false;
+        rotation += delta_time;
+        return true;
     }
 
     void add_model(Model m)
@@ -48,36 +143,236 @@ public:
         models.push_back(std::make_unique<Model>(std::move(m)));
     }
 
-    void setViewMatrix(const float *camera_view_matrix_ptr)
+    /**
+     * @brief World space ray through a point on screen
+     *
+     * @param ndc_x Horizontal position, -1 at the left edge and 1 at the right
+     * @param ndc_y Vertical position, -1 at the bottom and 1 at the top
+     */
+    void screen_ray(float ndc_x, float ndc_y, math::Vec3 &origin, math::Vec3 &direction) const
+    {
+        math::Mat4 inv_view_projection = math::inverse(projection * view);
+        math::Vec4 near_point = inv_view_projection * math::Vec4{ndc_x, ndc_y, -1.0f, 1.0f};
+        math::Vec4 far_point = inv_view_projection * math::Vec4{ndc_x, ndc_y, 1.0f, 1.0f};
+        origin = math::Vec3{near_point.x, near_point.y, near_point.z} * (1.0f / near_point.w);
+        direction = math::Vec3{far_point.x, far_point.y, far_point.z} * (1.0f / far_point.w) - origin;
+    }
+
+    /**
+     * @brief Casts a world space ray against every model with a BVH, as currently drawn
+     *
+     */
+    std::optional<PickResult> pick(const math::Vec3 &origin, const math::Vec3 &direction) const
+    {
+        std::optional<PickResult> result;
+        math::Mat4 spin = math::rotate_y(rotation);
+
+        size_t index = 0;
+        for (const auto &model : models)
+        {
+            if (model->bvh)
+            {
+                // The BVH is in model space, so bring the ray there; t stays comparable as the direction isn't normalised
+                math::Mat4 to_model = math::inverse(spin * model->transform);
+                math::Vec3 local_origin = math::transform_point(to_model, origin);
+                math::Vec3 local_direction = math::transform_vector(to_model, direction);
+
+                float t_max = result ? result->hit.t : INFINITY;
+                if (auto hit = model->bvh->raycast(local_origin, local_direction, t_max))
+                    result = PickResult{model.get(), index, *hit, origin + direction * hit->t,
+                                        math::length(direction * hit->t)};
+            }
+            index++;
+        }
+        return result;
+    }
+
+    /**
+     * @brief World matrices and bounds of every model as currently drawn, in one batch: spin * model transform
+     *
+     */
+    void update_world_bounds()
+    {
+        world_count = models.size();
+        math::Mat4 *local_transforms = frame_arena.allocate_array<math::Mat4>(world_count);
+        world_transforms = frame_arena.allocate_array<math::Mat4>(world_count);
+        world_bounds = frame_arena.allocate_array<math::AABB>(world_count);
+
+        size_t i = 0;
+        for (const auto &model : models)
+            new (&local_transforms[i++]) math::Mat4(model->transform);
+        math::mul_batch(math::rotate_y(rotation), local_transforms, world_transforms, world_count);
+
+        i = 0;
+        for (const auto &model : models)
+        {
+            math::transform_aabbs(world_transforms[i], &model->bounds(), &world_bounds[i], 1);
+            i++;
+        }
+    }
+
+    /**
+     * @brief Moves every model's world bounds into the broadphase, and finds the overlapping pairs if requested
+     *
+     * The broadphase refers to models by their index in models. The pair search is a full pass
+     * over the grid, so it only runs on frames after pair_search_requested was set, which it clears.
+     */
+    void update_collision()
+    {
+        update_world_bounds();
+        if (model_proxies.size() != world_count)
+        {
+            for (Broadphase::Proxy proxy : model_proxies)
+                broadphase.remove(proxy);
+            model_proxies.clear();
+            for (size_t i = 0; i < world_count; i++)
+                model_proxies.push_back(broadphase.add(world_bounds[i], static_cast<uint32_t>(i)));
+        }
+        else
+        {
+            for (size_t i = 0; i < world_count; i++)
+                broadphase.move(model_proxies[i], world_bounds[i]);
+        }
+        if (pair_search_requested)
+        {
+            broadphase.update();
+            pair_search_requested = false;
+        }
+    }
+
+    /**
+     * @brief Where a camera sphere at position ends up after being pushed out of every model's world bounds
+     *
+     * Uses the bounds of the last update_collision() in the same frame.
+     */
+    math::Vec3 collide_camera(math::Vec3 position)
+    {
+        math::Vec3 reach = {camera_radius, camera_radius, camera_radius};
+        FrameVector<uint32_t> nearby_models{FrameAllocator<uint32_t>(frame_arena)};
+        broadphase.query({position - reach, position + reach}, nearby_models);
+        camera_contacts = 0;
+        for (uint32_t index : nearby_models)
+        {
+            if (push_sphere_out(position, camera_radius, world_bounds[index]))
+                camera_contacts++;
+        }
+        return position;
+    }
+
+    void setViewMatrix(const math::Mat4 &camera_view_matrix)
     {
-        // Convert cglm mat4 (float[4][4]) to glm::mat4
-        view = glm::make_mat4(camera_view_matrix_ptr);
+        view = camera_view_matrix;
     }
 
+    /**
+     * @brief Draws every model into the scene framebuffer, call present() to show it
+     *
+     */
     void draw_models()
     {
+        glBindFramebuffer(GL_FRAMEBUFFER, scene_fbo);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         shader.use();
 
-        glm::mat4 model(1.0f);
-        model = glm::rotate(model, (GLfloat)glfwGetTime() * 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+        update_world_bounds();
 
         GLint modelLoc = glGetUniformLocation(shader.program, "model");
         GLint viewLoc = glGetUniformLocation(shader.program, "view");
         GLint projectionLoc = glGetUniformLocation(shader.program, "projection");
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view.data());
+        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, projection.data());
 
+        size_t i;
+        bool culling = false; // without occluders there is nothing to rasterize or test against
+        if (occlusion_culling)
+        {
+            culler.begin_frame(projection * view);
+            i = 0;
+            for (const auto &model : models)
+            {
+                if (model->occluder && model->has_cpu_mesh())
+                    culler.add_occluder(world_transforms[i], model->m_mesh->vertices.data(), model->m_mesh->vertices.size(),
+                                        model->m_mesh->indices.data(), model->m_mesh->indices.size());
+                i++;
+            }
+            culling = culler.has_occluders();
+            if (culling)
+                culler.finish();
+        }
+
+        drawn_models = 0;
+        i = 0;
         for (const auto &model : models)
         {
-            glBindVertexArray(model->m_vao);
-            glDrawElements(mode, model->m_mesh.indices.size(), GL_UNSIGNED_SHORT, 0);
+            size_t index = i++;
+            if (!model->m_buffers)
+                continue; // cleaned up
+            if (culling && !model->occluder && !culler.is_visible(world_bounds[index]))
+                continue;
+
+            drawn_models++;
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, world_transforms[index].data());
+            const GpuBuffers &buffers = *model->m_buffers;
+            if (mode == GL_LINES && buffers.edge_vao)
+            {
+                glBindVertexArray(buffers.edge_vao);
+                glDrawElements(GL_LINES, buffers.edge_index_count, GL_UNSIGNED_SHORT, 0);
+            }
+            else
+            {
+                glBindVertexArray(buffers.vao);
+                glDrawElements(mode, model->m_index_count, GL_UNSIGNED_SHORT, 0);
+            }
             glBindVertexArray(0);
         }
+
+        for (DynamicMesh *mesh : dynamic_meshes)
+        {
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, mesh->transform.data());
+            mesh->draw(mode);
+        }
+
+        if (point_cloud)
+        {
+            math::Mat4 world = math::rotate_y(rotation);
+            math::Mat4 to_model = math::inverse(view * world);
+            math::Vec4 eye = to_model * math::Vec4{0.0f, 0.0f, 0.0f, 1.0f};
+            point_cloud->select(projection * view * world, math::Vec3{eye.x, eye.y, eye.z} * (1.0f / eye.w),
+                                projection.cols[1].y * height * 0.5f);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, world.data());
+            point_cloud->draw();
+        }
+
+        drawn_pages = 0;
+        if (paged)
+        {
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, math::Mat4::identity().data());
+            paged->for_each_resident([&](const math::AABB &bounds, GLuint vao, GLsizei index_count) {
+                if (culling && !culler.is_visible(bounds))
+                    return;
+                drawn_pages++;
+                glBindVertexArray(vao);
+                glDrawElements(mode, index_count, GL_UNSIGNED_SHORT, 0);
+            });
+            glBindVertexArray(0);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    /**
+     * @brief Copies the last drawn scene to the window's framebuffer
+     *
+     */
+    void present()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 };
 
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Math.hpp"
+#include "Model.hpp"
+#include "load_obj.hpp"
+
+/**
+ * @brief Position, rotation about y and scale of a scene node relative to its parent
+ *
+ */
+struct SceneTransform
+{
+    math::Vec3 position = {0.0f, 0.0f, 0.0f};
+    float rotate_y = 0.0f; // degrees
+    math::Vec3 scale = {1.0f, 1.0f, 1.0f};
+
+    math::Mat4 matrix() const
+    {
+        return math::translate(position) * math::rotate_y(math::radians(rotate_y)) * math::scale(scale);
+    }
+};
+
+/**
+ * @brief One node of a scene file, in the order it was written
+ *
+ */
+struct SceneNodeDesc
+{
+    std::string name;
+    uint32_t parent = UINT32_MAX; // index of an earlier node, UINT32_MAX for a root
+    std::string model;            // empty for a group node, relative paths are resolved against the scene file
+    SceneTransform local;
+    bool occluder = false;
+};
+
+/**
+ * @brief Parses a scene file, one node per line:
+ *
+ *     node <name> [parent <name>] [model <path>] [position x y z] [rotate_y degrees] [scale x y z] [occluder]
+ *
+ * Lines starting with # are comments. A parent has to be declared before its children.
+ *
+ * @param path The scene file to load
+ * @param error Set to a message with the line number if the file is rejected
+ * @return std::optional<std::vector<SceneNodeDesc>> Either None or the nodes
+ */
+inline std::optional<std::vector<SceneNodeDesc>> load_scene_file(std::string_view path, std::string &error)
+{
+    std::optional<std::vector<SceneNodeDesc>> result;
+    std::ifstream file{std::string(path)};
+    if (!file)
+    {
+        error = "couldn't open " + std::string(path);
+        return result;
+    }
+
+    std::string directory;
+    size_t slash = path.find_last_of('/');
+    if (slash != path.npos)
+        directory = std::string(path.substr(0, slash + 1));
+
+    std::vector<SceneNodeDesc> nodes;
+    std::unordered_map<std::string, uint32_t> by_name;
+    std::string line;
+    std::vector<std::string_view> split_string;
+    size_t line_number = 0;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+        split_at_whitespace(line, split_string);
+        if (split_string.empty() || split_string[0][0] == '#')
+            continue;
+
+        auto fail = [&](const std::string &message) {
+            error = std::string(path) + ':' + std::to_string(line_number) + ": " + message;
+        };
+        if (split_string[0] != "node" || split_string.size() < 2)
+        {
+            fail("expected node <name>");
+            return result;
+        }
+
+        SceneNodeDesc node;
+        node.name = std::string(split_string[1]);
+        for (size_t i = 2; i < split_string.size(); i++)
+        {
+            std::string_view key = split_string[i];
+            size_t remaining = split_string.size() - i - 1;
+            if (key == "parent" && remaining >= 1)
+            {
+                auto found = by_name.find(std::string(split_string[++i]));
+                if (found == by_name.end())
+                {
+                    fail("parent " + std::string(split_string[i]) + " isn't declared before this node");
+                    return result;
+                }
+                node.parent = found->second;
+            }
+            else if (key == "model" && remaining >= 1)
+            {
+                std::string_view model = split_string[++i];
+                node.model = model[0] == '/' ? std::string(model) : directory + std::string(model);
+            }
+            else if (key == "position" && remaining >= 3)
+            {
+                node.local.position = {parse_float(split_string[i + 1]), parse_float(split_string[i + 2]),
+                                       parse_float(split_string[i + 3])};
+                i += 3;
+            }
+            else if (key == "rotate_y" && remaining >= 1)
+                node.local.rotate_y = parse_float(split_string[++i]);
+            else if (key == "scale" && remaining >= 3)
+            {
+                node.local.scale = {parse_float(split_string[i + 1]), parse_float(split_string[i + 2]),
+                                    parse_float(split_string[i + 3])};
+                i += 3;
+            }
+            else if (key == "occluder")
+                node.occluder = true;
+            else
+            {
+                fail("unexpected " + std::string(key));
+                return result;
+            }
+        }
+
+        if (!by_name.emplace(node.name, static_cast<uint32_t>(nodes.size())).second)
+        {
+            fail("node " + node.name + " is declared twice");
+            return result;
+        }
+        nodes.push_back(std::move(node));
+    }
+
+    result.emplace(std::move(nodes));
+    return result;
+}
+
+/**
+ * @brief A transform hierarchy stored as a flat depth-first array, updating only what changed.
+ *
+ * Every subtree is a contiguous range [node, subtree_end(node)) with parents before their
+ * children, so recomputing a subtree's world matrices is a single forward pass over memory.
+ * Changing a node's local transform only queues it; update() then walks the queued subtrees
+ * (skipping ones nested inside another queued subtree) and leaves every other node alone, so a
+ * frame where nothing moved costs nothing regardless of the scene size.
+ *
+ */
+class SceneGraph
+{
+public:
+    static constexpr uint32_t no_parent = UINT32_MAX;
+
+    struct Stats
+    {
+        size_t nodes = 0;
+        size_t dirty_roots = 0;   // subtrees recomputed by the last update that changed anything
+        size_t updated_nodes = 0; // world matrices recomputed by that update
+        float update_us = 0.0f;
+        size_t updates = 0; // updates that changed anything
+    };
+
+private:
+    // Structure of arrays, indexed by depth-first position
+    std::vector<std::string> m_names;
+    std::vector<uint32_t> m_parent;
+    std::vector<uint32_t> m_subtree_end;
+    std::vector<uint32_t> m_source; // index in the description the node was built from
+    std::vector<SceneTransform> m_local;
+    std::vector<math::Mat4> m_local_matrix;
+    std::vector<math::Mat4> m_world;
+    std::vector<Model *> m_models;
+
+    std::vector<uint8_t> m_queued;   // local transform changed since the last update
+    std::vector<uint32_t> m_dirty;   // nodes with m_queued set
+    std::unordered_map<std::string, uint32_t> m_by_name;
+
+    Stats m_stats;
+
+public:
+    /**
+     * @brief Replaces the scene with the described nodes, every node starts out dirty
+     *
+     */
+    void build(const std::vector<SceneNodeDesc> &nodes)
+    {
+        size_t count = nodes.size();
+
+        // Children in declaration order, as ranges into one array
+        std::vector<uint32_t> child_start(count + 1, 0);
+        for (const SceneNodeDesc &node : nodes)
+        {
+            if (node.parent != no_parent)
+                child_start[node.parent + 1]++;
+        }
+        for (size_t i = 0; i < count; i++)
+            child_start[i + 1] += child_start[i];
+        std::vector<uint32_t> children(child_start[count]);
+        std::vector<uint32_t> fill(child_start.begin(), child_start.end() - 1);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (nodes[i].parent != no_parent)
+                children[fill[nodes[i].parent]++] = i;
+        }
+
+        // Depth-first order, parents declare before children so every root is found in order
+        m_source.clear();
+        m_source.reserve(count);
+        std::vector<uint32_t> stack;
+        for (uint32_t root = 0; root < count; root++)
+        {
+            if (nodes[root].parent != no_parent)
+                continue;
+            stack.push_back(root);
+            while (!stack.empty())
+            {
+                uint32_t desc = stack.back();
+                stack.pop_back();
+                m_source.push_back(desc);
+                for (uint32_t c = child_start[desc + 1]; c > child_start[desc]; c--)
+                    stack.push_back(children[c - 1]); // reversed so the first child pops first
+            }
+        }
+
+        std::vector<uint32_t> position_of(count);
+        for (uint32_t i = 0; i < count; i++)
+            position_of[m_source[i]] = i;
+
+        m_names.resize(count);
+        m_parent.resize(count);
+        m_subtree_end.resize(count);
+        m_local.resize(count);
+        m_local_matrix.resize(count);
+        m_world.assign(count, math::Mat4::identity());
+        m_models.assign(count, nullptr);
+        m_queued.assign(count, 1);
+        m_dirty.clear();
+        m_by_name.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const SceneNodeDesc &node = nodes[m_source[i]];
+            m_names[i] = node.name;
+            m_parent[i] = node.parent == no_parent ? no_parent : position_of[node.parent];
+            m_local[i] = node.local;
+            m_subtree_end[i] = i + 1;
+            m_by_name.emplace(node.name, i);
+        }
+        // Children follow their parent, so a backward pass sees every subtree complete
+        for (uint32_t i = static_cast<uint32_t>(count); i-- > 0;)
+        {
+            if (m_parent[i] != no_parent)
+                m_subtree_end[m_parent[i]] = std::max(m_subtree_end[m_parent[i]], m_subtree_end[i]);
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (m_parent[i] == no_parent)
+                m_dirty.push_back(i);
+        }
+
+        m_stats = {};
+        m_stats.nodes = count;
+    }
+
+    /**
+     * @brief Lets the node drive a model's transform, the model has to outlive the scene
+     *
+     */
+    void attach(uint32_t node, Model *model)
+    {
+        m_models[node] = model;
+        if (model && !m_queued[node])
+        {
+            m_queued[node] = 1;
+            m_dirty.push_back(node);
+        }
+    }
+
+    void set_local(uint32_t node, const SceneTransform &local)
+    {
+        m_local[node] = local;
+        if (!m_queued[node])
+        {
+            m_queued[node] = 1;
+            m_dirty.push_back(node);
+        }
+    }
+
+    /**
+     * @brief Recomputes the world matrices of the subtrees changed since the last call
+     *
+     * @return true if any world matrix (and so any attached model's transform) changed
+     */
+    bool update()
+    {
+        if (m_dirty.empty())
+            return false;
+
+        auto start = std::chrono::steady_clock::now();
+        std::sort(m_dirty.begin(), m_dirty.end());
+
+        size_t roots = 0, updated = 0;
+        uint32_t covered_end = 0; // nodes before this were recomputed by an earlier root
+        for (uint32_t root : m_dirty)
+        {
+            if (root < covered_end)
+                continue; // nested in a subtree already recomputed
+            roots++;
+            covered_end = m_subtree_end[root];
+            for (uint32_t i = root; i < covered_end; i++)
+            {
+                if (m_queued[i])
+                {
+                    m_local_matrix[i] = m_local[i].matrix();
+                    m_queued[i] = 0;
+                }
+                m_world[i] = m_parent[i] == no_parent ? m_local_matrix[i] : m_world[m_parent[i]] * m_local_matrix[i];
+                if (m_models[i])
+                    m_models[i]->transform = m_world[i];
+            }
+            updated += covered_end - root;
+        }
+        m_dirty.clear();
+
+        m_stats.dirty_roots = roots;
+        m_stats.updated_nodes = updated;
+        m_stats.update_us =
+            std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+        m_stats.updates++;
+        return true;
+    }
+
+    /**
+     * @brief Node index of a name, no_parent if there is no such node
+     *
+     */
+    uint32_t find(std::string_view name) const
+    {
+        auto found = m_by_name.find(std::string(name));
+        return found == m_by_name.end() ? no_parent : found->second;
+    }
+
+    size_t size() const { return m_names.size(); }
+    const std::string &name(uint32_t node) const { return m_names[node]; }
+    uint32_t parent(uint32_t node) const { return m_parent[node]; }
+    uint32_t subtree_end(uint32_t node) const { return m_subtree_end[node]; }
+    uint32_t source(uint32_t node) const { return m_source[node]; }
+    const SceneTransform &local(uint32_t node) const { return m_local[node]; }
+    const math::Mat4 &world(uint32_t node) const { return m_world[node]; }
+    const Stats &stats() const { return m_stats; }
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Menu.hpp"
+#include "SceneGraph.hpp"
+#include <algorithm>
+
+namespace GUI {
+
+    class SceneWidget : public Widget {
+    public:
+        SceneWidget(SceneGraph& scene) : m_Scene(scene) {}
+
+        void Render() override {
+            if (!ImGui::CollapsingHeader("Scene graph"))
+                return;
+
+            const SceneGraph::Stats& stats = m_Scene.stats();
+            ImGui::Text("%zu nodes, %zu updates", stats.nodes, stats.updates);
+            ImGui::Text("Last update: %zu subtrees, %zu nodes in %.1f us", stats.dirty_roots, stats.updated_nodes,
+                        stats.update_us);
+            if (m_Scene.size() == 0)
+                return;
+
+            ImGui::Separator();
+            ImGui::InputInt("Node", &m_Node);
+            m_Node = std::max(0, std::min(m_Node, static_cast<int>(m_Scene.size()) - 1));
+            uint32_t node = static_cast<uint32_t>(m_Node);
+            uint32_t parent = m_Scene.parent(node);
+            ImGui::Text("%s, parent %s, %u descendants", m_Scene.name(node).c_str(),
+                        parent == SceneGraph::no_parent ? "none" : m_Scene.name(parent).c_str(),
+                        m_Scene.subtree_end(node) - node - 1);
+
+            // Edits only queue the node, the world matrices are recomputed by the next update
+            SceneTransform local = m_Scene.local(node);
+            bool changed = ImGui::DragFloat3("Position", &local.position.x, 0.05f);
+            changed |= ImGui::SliderFloat("Rotation y", &local.rotate_y, -180.0f, 180.0f);
+            changed |= ImGui::DragFloat3("Scale", &local.scale.x, 0.01f);
+            if (changed)
+                m_Scene.set_local(node, local);
+        }
+
+    private:
+        SceneGraph& m_Scene;
+        int m_Node = 0;
+    };
+
+}
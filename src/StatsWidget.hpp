@@ -0,0 +1,41 @@
+#pragma once
+
+#include "FrameStats.hpp"
+#include "Menu.hpp"
+#include <cstdio>
+
+namespace GUI {
+
+    class StatsWidget : public Widget {
+    public:
+        StatsWidget(const FrameStats& stats, double& time, int& ticks)
+            : m_Stats(stats), m_Time(time), m_Ticks(ticks) {}
+
+        void Render() override {
+            FrameStats::Summary s = m_Stats.summary();
+
+            ImGui::Text("FPS: %.1f", s.avg_ms > 0.0f ? 1000.0f / s.avg_ms : 0.0f);
+            ImGui::Text("Time: %.2f", m_Time);
+            ImGui::Text("Ticks: %d", m_Ticks);
+
+            ImGui::Separator();
+            ImGui::Text("Frame time (last %zu frames)", m_Stats.count());
+            ImGui::Text("min %.2f  avg %.2f  max %.2f ms", s.min_ms, s.avg_ms, s.max_ms);
+            ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f ms", s.p50_ms, s.p95_ms, s.p99_ms);
+            ImGui::Text("Hitches: %u (total %llu)", s.hitches,
+                        static_cast<unsigned long long>(m_Stats.total_hitches()));
+
+            // Stack buffer keeps the overlay allocation free
+            char overlay[32];
+            std::snprintf(overlay, sizeof(overlay), "p99 %.2f ms", s.p99_ms);
+            ImGui::PlotLines("##FrameTimes", m_Stats.samples(), static_cast<int>(m_Stats.count()),
+                             static_cast<int>(m_Stats.offset()), overlay, 0.0f, s.max_ms * 1.1f, ImVec2(0, 60));
+        }
+
+    private:
+        const FrameStats& m_Stats;
+        double& m_Time;
+        int& m_Ticks;
+    };
+
+}
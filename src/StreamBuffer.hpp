@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * @brief A GPU buffer split into regions written by the CPU in turn, one region per frame.
+ *
+ * While the GPU still reads the region drawn last frame (or the one before), the CPU writes the
+ * next one, so updating never waits for the draw that used the old data and the buffer is never
+ * reallocated. Every region gets a fence after the draws that read it, and is only written again
+ * once that fence has passed; with three regions that wait is normally already over.
+ *
+ * With ARB_buffer_storage (GL 4.4) the whole buffer stays mapped persistently and coherently,
+ * otherwise each region is mapped unsynchronized for the write, which the fences make safe.
+ *
+ */
+class StreamBuffer
+{
+public:
+    struct Stats
+    {
+        size_t writes = 0;
+        size_t stalls = 0;       // writes that had to wait for the GPU to finish with the region
+        float last_wait_us = 0.0f;
+        float total_wait_ms = 0.0f;
+        size_t lost_writes = 0;  // unmaps that reported the data as corrupted, see glUnmapBuffer
+    };
+
+private:
+    GLenum m_target;
+    GLuint m_buffer = 0;
+    size_t m_region_bytes;
+    size_t m_regions;
+    size_t m_current;          // region last written
+    std::vector<GLsync> m_fences; // per region, null if nothing reads it
+    uint8_t *m_persistent = nullptr;
+    bool m_mapped = false;
+    Stats m_stats;
+
+public:
+    /**
+     * @param target What the buffer is bound as when written, like GL_ARRAY_BUFFER
+     * @param region_bytes Bytes written per frame
+     * @param regions How many frames the CPU can run ahead of the GPU plus one, at least 2
+     */
+    StreamBuffer(GLenum target, size_t region_bytes, size_t regions = 3)
+        : m_target(target), m_region_bytes(region_bytes), m_regions(regions < 2 ? 2 : regions), m_current(m_regions - 1),
+          m_fences(m_regions, nullptr)
+    {
+        size_t total = m_region_bytes * m_regions;
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(m_target, m_buffer);
+        if (GLEW_ARB_buffer_storage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(m_target, total, nullptr, flags);
+            m_persistent = static_cast<uint8_t *>(glMapBufferRange(m_target, 0, total, flags));
+        }
+        else
+            glBufferData(m_target, total, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(m_target, 0);
+    }
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    ~StreamBuffer()
+    {
+        for (GLsync fence : m_fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+        }
+        if (m_persistent || m_mapped)
+        {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    /**
+     * @brief Moves to the next region and returns it for writing, waiting for the GPU only if it still reads it
+     *
+     * Leaves the buffer bound to its target when it isn't persistently mapped. Every byte of the
+     * region should be written, its old contents are discarded. Null if the region couldn't be mapped.
+     */
+    void *begin_write()
+    {
+        m_current = (m_current + 1) % m_regions;
+        if (GLsync fence = m_fences[m_current])
+        {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                auto start = std::chrono::steady_clock::now();
+                // The first wait flushes, so the fence is guaranteed to be submitted and signal eventually
+                while ((status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000)) == GL_TIMEOUT_EXPIRED)
+                    ;
+                m_stats.stalls++;
+                m_stats.last_wait_us =
+                    std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+                m_stats.total_wait_ms += m_stats.last_wait_us / 1000.0f;
+            }
+            glDeleteSync(fence);
+            m_fences[m_current] = nullptr;
+        }
+        m_stats.writes++;
+
+        if (m_persistent)
+            return m_persistent + offset();
+
+        glBindBuffer(m_target, m_buffer);
+        void *region = glMapBufferRange(m_target, offset(), m_region_bytes,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        m_mapped = region != nullptr;
+        return region;
+    }
+
+    /**
+     * @brief Finishes the write started by begin_write(), the region can be drawn from afterwards
+     *
+     */
+    void end_write()
+    {
+        if (!m_mapped)
+            return;
+        glBindBuffer(m_target, m_buffer);
+        if (glUnmapBuffer(m_target) == GL_FALSE)
+            m_stats.lost_writes++;
+        glBindBuffer(m_target, 0);
+        m_mapped = false;
+    }
+
+    /**
+     * @brief Marks the draws issued so far as the last readers of a region, usually the current one
+     *
+     * Call after every batch of draws that reads the region, a region drawn again on a later
+     * frame replaces its fence with the newer one.
+     */
+    void fence(size_t region)
+    {
+        GLsync &fence = m_fences[region];
+        if (fence)
+            glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    GLuint id() const { return m_buffer; }
+    size_t region() const { return m_current; }
+    size_t regions() const { return m_regions; }
+    size_t region_bytes() const { return m_region_bytes; }
+    size_t offset() const { return m_current * m_region_bytes; }
+    bool persistent() const { return m_persistent != nullptr; }
+    const Stats &stats() const { return m_stats; }
+};
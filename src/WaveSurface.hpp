@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cmath>
+#include <new>
+#include <vector>
+
+#include "DynamicMesh.hpp"
+#include "JobSystem.hpp"
+#include "Math.hpp"
+
+/**
+ * @brief A procedurally animated grid of ripples, regenerated on the CPU every frame.
+ *
+ * Exercises the dynamic geometry path: every update writes all the vertices straight into the
+ * mapped stream buffer, split by rows across the job system.
+ *
+ */
+class WaveSurface
+{
+    size_t m_resolution; // vertices per side
+    DynamicMesh m_mesh;
+
+    static std::vector<GLushort> grid_indices(size_t resolution)
+    {
+        std::vector<GLushort> indices;
+        indices.reserve((resolution - 1) * (resolution - 1) * 6);
+        for (size_t z = 0; z + 1 < resolution; z++)
+        {
+            for (size_t x = 0; x + 1 < resolution; x++)
+            {
+                GLushort a = static_cast<GLushort>(z * resolution + x);
+                GLushort b = static_cast<GLushort>(a + 1);
+                GLushort c = static_cast<GLushort>(a + resolution);
+                GLushort d = static_cast<GLushort>(c + 1);
+                indices.insert(indices.end(), {a, c, b, b, c, d});
+            }
+        }
+        return indices;
+    }
+
+public:
+    float size = 8.0f;       // world units per side
+    float amplitude = 0.15f;
+    float wavelength = 1.0f;
+    float speed = 2.0f;      // radians of phase per second
+
+    /**
+     * @param resolution Vertices per side, at most 256 so the grid fits 16 bit indices
+     */
+    WaveSurface(size_t resolution = 128)
+        : m_resolution(resolution), m_mesh(resolution * resolution, grid_indices(resolution))
+    {
+        m_mesh.transform = math::translate({0.0f, -1.5f, 0.0f});
+    }
+
+    /**
+     * @brief Writes the surface at a point in time into the next region of the mesh
+     *
+     */
+    void update(float time, JobSystem &jobs = JobSystem::shared())
+    {
+        Vertex *out = m_mesh.begin_update();
+        if (out)
+        {
+            float step = size / (m_resolution - 1);
+            float k = 2.0f * 3.14159265f / wavelength;
+            jobs.parallel_for(0, m_resolution, 16, [&](size_t b, size_t e) {
+                for (size_t z = b; z < e; z++)
+                {
+                    float pz = z * step - size * 0.5f;
+                    for (size_t x = 0; x < m_resolution; x++)
+                    {
+                        float px = x * step - size * 0.5f;
+                        float wave = std::sin(k * std::sqrt(px * px + pz * pz) - speed * time);
+                        float shade = 0.5f + 0.5f * wave;
+                        // The mapped memory holds no objects yet, so construct rather than assign
+                        new (&out[z * m_resolution + x])
+                            Vertex({px, amplitude * wave, pz}, {0.1f, 0.3f + 0.4f * shade, 0.6f + 0.4f * shade});
+                    }
+                }
+            });
+        }
+        m_mesh.end_update();
+    }
+
+    DynamicMesh &mesh() { return m_mesh; }
+};
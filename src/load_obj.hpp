@@ -1,6 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <iterator>
 #include <optional>
@@ -9,6 +12,7 @@
 #include <string_view>
 #include <vector>
 
+#include "Math.hpp"
 #include "Mesh.hpp"
 #include "Model.hpp"
 
@@ -47,79 +51,208 @@ inline std::string extract_first_num(const std::string &str, char delim)
 }
 
 /**
- * @brief Loads a wavefront .obj file into a Model
+ * @brief Splits a string at whitespace into views of that string, reusing the storage of result
+ *
+ * @param s The string to split, must outlive result
+ * @param result Cleared and filled with the split sections of the string
+ */
+inline void split_at_whitespace(std::string_view s, std::vector<std::string_view> &result)
+{
+	result.clear();
+	size_t i = 0;
+	while (i < s.size())
+	{
+		while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i])))
+			i++;
+		size_t start = i;
+		while (i < s.size() && !std::isspace(static_cast<unsigned char>(s[i])))
+			i++;
+		if (i > start)
+			result.push_back(s.substr(start, i - start));
+	}
+}
+
+/**
+ * @brief Parses a float from a token of a whitespace split line, 0 if it isn't a number
+ *
+ */
+inline GLfloat parse_float(std::string_view token)
+{
+	// strtof stops at the whitespace that ends the token, so no null terminated copy is needed
+	return std::strtof(token.data(), nullptr);
+}
+
+/**
+ * @brief Parses the first number of a face token, i.e 15 in 15/22/50
+ *
+ */
+inline long parse_first_index(std::string_view token)
+{
+	return std::strtol(token.data(), nullptr, 10);
+}
+
+/**
+ * @brief Parses a wavefront .obj file into a Mesh, without touching OpenGL
  *
  * @param filename The .obj file to load
- * @param color The color of the model, defaults to white (1.0f, 1.0f, 1.0f)
- * @return std::optional<Model> Either None or the Model
+ * @param color The color of the mesh, defaults to white (1.0f, 1.0f, 1.0f)
+ * @return std::optional<Mesh> Either None or the Mesh
  */
-inline std::optional<Model> load_obj(std::string_view filename, std::array<GLfloat, 3> color = {1.0f, 1.0f, 1.0f})
+inline std::optional<Mesh> load_obj_mesh(std::string_view filename, std::array<GLfloat, 3> color = {1.0f, 1.0f, 1.0f})
 {
-	std::optional<Model> model;
+	std::optional<Mesh> mesh;
 	std::fstream file{std::string(filename)};
 	if (!file)
 	{
-		return model; // couldn't open file
+		return mesh; // couldn't open file
 	}
 
 	std::string line;
 	std::vector<Vertex> vertices;
 	std::vector<GLushort> indices;
 
-	std::array<std::string, 3> pos_array_str;
 	std::array<GLfloat, 3> pos_array_float;
 
-	std::string index, index1, index2, index3, index4;
+	// Reused for every line so parsing doesn't allocate per line
+	std::vector<std::string_view> split_string;
 
 	while (std::getline(file, line))
 	{
 		if (line.empty())
 			continue;
 
-		auto split_string = split_at_whitespace(line);
+		split_at_whitespace(line, split_string);
+		if (split_string.empty())
+			continue; // whitespace only
 
-		std::string line_type = split_string[0];
+		std::string_view line_type = split_string[0];
 
-		if (line_type == "v") // vertex information
+		if (line_type == "v" && split_string.size() >= 4) // vertex information
 		{
 			for (int i = 0; i < 3; i++)
 			{
-				pos_array_float[i] = std::stof(split_string[i + 1]);
+				pos_array_float[i] = parse_float(split_string[i + 1]);
 			}
 			vertices.push_back(Vertex(pos_array_float, color));
 		}
 
-		else if (line_type == "f") // face information
+		else if (line_type == "f" && split_string.size() >= 4) // face information
 		{
 			if (split_string.size() == 5) // f looks like "f 1 2 3 4"
 			{
+				long index1 = parse_first_index(split_string[1]);
+				long index2 = parse_first_index(split_string[2]);
+				long index3 = parse_first_index(split_string[3]);
+				long index4 = parse_first_index(split_string[4]);
 
-				index1 = extract_first_num(split_string[1], '/');
-				index2 = extract_first_num(split_string[2], '/');
-				index3 = extract_first_num(split_string[3], '/');
-				index4 = extract_first_num(split_string[4], '/');
+				indices.push_back(index1 - 1);
+				indices.push_back(index2 - 1);
+				indices.push_back(index3 - 1);
 
-				indices.push_back(std::stoi(index1) - 1);
-				indices.push_back(std::stoi(index2) - 1);
-				indices.push_back(std::stoi(index3) - 1);
-
-				indices.push_back(std::stoi(index1) - 1);
-				indices.push_back(std::stoi(index3) - 1);
-				indices.push_back(std::stoi(index4) - 1);
+				indices.push_back(index1 - 1);
+				indices.push_back(index3 - 1);
+				indices.push_back(index4 - 1);
 
 				continue;
 			}
 			for (int i = 0; i < 3; i++)
 			{
-				index = split_string[i + 1];
 				// just in case if line looks like "f 1/2/3 ..."
-				index = extract_first_num(index, '/');
+				indices.push_back(parse_first_index(split_string[i + 1]) - 1); // faces start at 1 :O
+			}
+		}
+	}
+
+	mesh.emplace(std::move(vertices), std::move(indices));
+	return mesh;
+}
+
+/**
+ * @brief Parses the positions of a wavefront .obj file, and its triangles unless triangles is null
+ *
+ */
+inline bool load_obj_geometry(std::string_view filename, std::vector<math::Vec3> &positions, std::vector<uint32_t> *triangles)
+{
+	std::fstream file{std::string(filename)};
+	if (!file)
+	{
+		return false;
+	}
 
-				indices.push_back(std::stoi(index) - 1); // faces start at 1 :O
+	std::string line;
+	std::vector<std::string_view> split_string;
+
+	while (std::getline(file, line))
+	{
+		split_at_whitespace(line, split_string);
+		if (split_string.empty())
+			continue;
+
+		std::string_view line_type = split_string[0];
+
+		if (line_type == "v" && split_string.size() >= 4)
+		{
+			positions.push_back({parse_float(split_string[1]), parse_float(split_string[2]), parse_float(split_string[3])});
+		}
+		else if (triangles && line_type == "f" && split_string.size() >= 4)
+		{
+			// Fan triangulation, the same as load_obj_mesh for quads
+			uint32_t first = static_cast<uint32_t>(parse_first_index(split_string[1]) - 1);
+			for (size_t i = 2; i + 1 < split_string.size(); i++)
+			{
+				triangles->push_back(first);
+				triangles->push_back(static_cast<uint32_t>(parse_first_index(split_string[i]) - 1));
+				triangles->push_back(static_cast<uint32_t>(parse_first_index(split_string[i + 1]) - 1));
 			}
 		}
 	}
+	return true;
+}
+
+/**
+ * @brief Parses only the positions and triangles of a wavefront .obj file, with 32 bit indices
+ *
+ * Unlike load_obj_mesh this isn't limited to what a Mesh can index, it's meant for offline tools
+ * like packing geometry pages.
+ *
+ * @param filename The .obj file to load
+ * @param positions Filled with the vertex positions
+ * @param triangles Filled with three indices into positions per triangle
+ * @return false if the file couldn't be opened
+ */
+inline bool load_obj_triangles(std::string_view filename, std::vector<math::Vec3> &positions, std::vector<uint32_t> &triangles)
+{
+	return load_obj_geometry(filename, positions, &triangles);
+}
+
+/**
+ * @brief Parses only the vertex positions of a wavefront .obj file, for point clouds
+ *
+ * Faces are skipped, so nothing is allocated for them however many the file has.
+ *
+ * @return false if the file couldn't be opened
+ */
+inline bool load_obj_positions(std::string_view filename, std::vector<math::Vec3> &positions)
+{
+	return load_obj_geometry(filename, positions, nullptr);
+}
+
+/**
+ * @brief Loads a wavefront .obj file into a Model
+ *
+ * @param filename The .obj file to load
+ * @param color The color of the model, defaults to white (1.0f, 1.0f, 1.0f)
+ * @return std::optional<Model> Either None or the Model
+ */
+inline std::optional<Model> load_obj(std::string_view filename, std::array<GLfloat, 3> color = {1.0f, 1.0f, 1.0f})
+{
+	std::optional<Model> model;
+	std::optional<Mesh> mesh = load_obj_mesh(filename, color);
+	if (!mesh.has_value())
+	{
+		return model;
+	}
 
-	model = std::move(Mesh(vertices, indices));
+	model.emplace(std::move(mesh.value()));
 	return model;
 };
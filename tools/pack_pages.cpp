@@ -0,0 +1,47 @@
+// Packs a wavefront .obj file into spatial geometry pages that the engine streams on demand.
+//
+// usage: ./pack_pages (obj_file) (pages_file) [triangles per page, default 16384]
+//
+// The packer itself holds the whole model in memory, only the engine side is out of core.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "../src/GeometryPages.hpp"
+#include "../src/load_obj.hpp"
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cout << "usage: ./pack_pages (obj_file) (pages_file) [triangles per page]\n";
+    return 0;
+  }
+
+  size_t max_triangles = 16384;
+  if (argc >= 4)
+    max_triangles = std::strtoul(argv[3], nullptr, 10);
+
+  std::vector<math::Vec3> positions;
+  std::vector<uint32_t> triangles;
+  if (!load_obj_triangles(argv[1], positions, triangles)) {
+    std::cerr << "Couldn't load file: " << argv[1] << '\n';
+    return 1;
+  }
+
+  if (!write_geometry_pages(argv[2], positions, triangles, {1.0f, 1.0f, 1.0f}, max_triangles)) {
+    std::cerr << "Couldn't write pages to: " << argv[2] << '\n';
+    return 1;
+  }
+
+  PageFileHeader header;
+  std::vector<PageEntry> entries;
+  read_page_directory(argv[2], header, entries);
+  std::cout << positions.size() << " vertices, " << triangles.size() / 3 << " triangles -> " << entries.size()
+            << " pages\n";
+  return 0;
+}